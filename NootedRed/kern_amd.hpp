@@ -123,6 +123,18 @@ struct GPUInfoFirmware {
     uint32_t gcLdsSize;
 } PACKED;
 
+/** What we take from `GPUInfoFirmware`, decoded once per boot. */
+struct GPUTopology {
+    uint32_t seCount;
+    uint32_t shPerSE;
+    uint32_t cuPerSH;
+    uint32_t rbPerSE;
+    uint32_t tccCount;
+    uint32_t waveSize;
+    uint32_t maxWavesPerSimd;
+    uint32_t ldsSize;
+};
+
 struct CAILAsicCapsEntry {
     uint32_t familyId, deviceId;
     uint32_t revision, extRevision;
@@ -170,6 +182,11 @@ struct DeviceCapabilityEntry {
 
 constexpr uint64_t DEVICE_CAP_ENTRY_REV_DONT_CARE = 0xDEADCAFEU;
 
+/** `_eAMD_HW_ENGINE_TYPE` values we route. */
+constexpr uint32_t AMD_HW_ENGINE_SDMA0 = 1;
+constexpr uint32_t AMD_HW_ENGINE_SDMA1 = 2;
+constexpr size_t AMD_HW_ENGINE_COUNT = 16;
+
 enum VideoMemoryType : uint32_t {
     kVideoMemoryTypeUnknown,
     kVideoMemoryTypeDDR2,
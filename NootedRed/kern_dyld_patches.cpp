@@ -97,7 +97,7 @@ void DYLDPatches::csValidatePage(vnode *vp, memory_object_t pager, memory_object
     patch.apply(const_cast<void *>(data), PAGE_SIZE);
 
     // ----------------------------------------------
-    if (NRed::callback->chipType >= ChipType::Renoir) { return; }    // Everything after is for VCN 1
+    if (NRed::callback->chipProfile->vcn2) { return; }    // Everything after is for VCN 1
     // ----------------------------------------------
 
     const DYLDPatch vcn1Patches[] = {
@@ -18,12 +18,22 @@ X5000HWLibs *X5000HWLibs::callback = nullptr;
 
 void X5000HWLibs::init() {
     callback = this;
+
+    this->sdmaPowerLock = IOLockAlloc();
+    PANIC_COND(!this->sdmaPowerLock, "hwlibs", "Failed to allocate SDMA power lock");
+    this->sdmaPowerDownCall = thread_call_allocate(processSdmaPowerDown, this);
+    PANIC_COND(!this->sdmaPowerDownCall, "hwlibs", "Failed to allocate SDMA power down thread call");
+    uint32_t delay = SDMA_POWER_DOWN_DELAY_MSEC;
+    PE_parse_boot_argn("nredsdmapgdelay", &delay, sizeof(delay));
+    nanoseconds_to_absolutetime(delay * 1000000ULL, &this->sdmaPowerDownDelay);
+    DBGLOG("hwlibs", "SDMA power down delay: %u ms", delay);
+
     lilu.onKextLoadForce(&kextRadeonX5000HWLibs);
 }
 
 bool X5000HWLibs::processKext(KernelPatcher &patcher, size_t index, mach_vm_address_t address, size_t size) {
     if (kextRadeonX5000HWLibs.loadIndex == index) {
-        NRed::callback->setRMMIOIfNecessary();
+        if (!NRed::callback->setRMMIOIfNecessary()) { return true; }
 
         CAILAsicCapsEntry *orgCapsTable = nullptr;
         CAILAsicCapsInitEntry *orgCapsInitTable = nullptr;
@@ -65,7 +75,7 @@ bool X5000HWLibs::processKext(KernelPatcher &patcher, size_t index, mach_vm_addr
             .revision = NRed::callback->revision,
             .extRevision = static_cast<uint32_t>(NRed::callback->enumRevision) + NRed::callback->revision,
             .pciRevision = NRed::callback->pciRevision,
-            .caps = NRed::callback->chipType < ChipType::Renoir ? ddiCapsRaven : ddiCapsRenoir,
+            .caps = NRed::callback->chipProfile->ddiCaps,
         };
         auto found = false;
         while (orgCapsInitTable->deviceId != 0xFFFFFFFF) {
@@ -130,11 +140,10 @@ bool X5000HWLibs::processKext(KernelPatcher &patcher, size_t index, mach_vm_addr
 void X5000HWLibs::wrapPopulateFirmwareDirectory(void *that) {
     FunctionCast(wrapPopulateFirmwareDirectory, callback->orgPopulateFirmwareDirectory)(that);
 
-    auto isRenoirDerivative = NRed::callback->chipType >= ChipType::Renoir;
-    auto *filename = isRenoirDerivative ? "ativvaxy_nv.dat" : "ativvaxy_rv.dat";
+    auto *profile = NRed::callback->chipProfile;
+    auto *filename = profile->vcnFirmware;
     auto &fwDesc = getFWDescByName(filename);
-    /** VCN 2.2, VCN 1.0 */
-    auto *fw = callback->orgCreateFirmware(fwDesc.data, fwDesc.size, isRenoirDerivative ? 0x0202 : 0x0100, filename);
+    auto *fw = callback->orgCreateFirmware(fwDesc.data, fwDesc.size, profile->vcnIPVersion, filename);
     PANIC_COND(!fw, "hwlibs", "Failed to create '%s' firmware", filename);
     DBGLOG("hwlibs", "Inserting %s!", filename);
     auto *fwDir = getMember<void *>(that, getKernelVersion() > KernelVersion::BigSur ? 0xB0 : 0xB8);
@@ -144,16 +153,66 @@ void X5000HWLibs::wrapPopulateFirmwareDirectory(void *that) {
 
 CAILResult X5000HWLibs::hwLibsNoop() { return kCAILResultSuccess; }
 
+/**
+ * SDMA must be powered before the caller uses it, so this is synchronous.
+ * A pending power down is called off instead, and SDMA that is already up is left alone unless `force` is set.
+ */
+void X5000HWLibs::powerUpSdma(bool force) {
+    IOLockLock(this->sdmaPowerLock);
+    if (this->sdmaPowerDownPending) {
+        this->sdmaPowerDownPending = false;
+        thread_call_cancel(this->sdmaPowerDownCall);
+    }
+    if (force || this->sdmaPowerState != SdmaPowerState::Up) {
+        PANIC_COND(NRed::callback->sendMsgToSmc(PPSMC_MSG_PowerUpSdma) != kCAILResultSuccess, "hwlibs",
+            "Failed to power up SDMA");
+        this->sdmaPowerState = SdmaPowerState::Up;
+    }
+    IOLockUnlock(this->sdmaPowerLock);
+}
+
+/**
+ * Nothing waits on SDMA powering down, so it is deferred until SDMA has been idle for the power down delay.
+ * Bursty traffic then keeps SDMA up instead of toggling it on every burst.
+ */
+void X5000HWLibs::requestSdmaPowerDown() {
+    IOLockLock(this->sdmaPowerLock);
+    if (this->sdmaPowerState != SdmaPowerState::Down && !this->sdmaPowerDownPending) {
+        if (this->sdmaPowerDownDelay) {
+            this->sdmaPowerDownPending = true;
+            thread_call_enter_delayed(this->sdmaPowerDownCall, mach_absolute_time() + this->sdmaPowerDownDelay);
+        } else {
+            NRed::callback->queueMsgToSmc(PPSMC_MSG_PowerDownSdma);
+            this->sdmaPowerState = SdmaPowerState::Down;
+        }
+    }
+    IOLockUnlock(this->sdmaPowerLock);
+}
+
+void X5000HWLibs::processSdmaPowerDown(thread_call_param_t param0, thread_call_param_t) {
+    auto *that = static_cast<X5000HWLibs *>(param0);
+    IOLockLock(that->sdmaPowerLock);
+    // A power up in the meantime called this off.
+    if (that->sdmaPowerDownPending) {
+        that->sdmaPowerDownPending = false;
+        NRed::callback->sendMsgToSmc(PPSMC_MSG_PowerDownSdma);
+        that->sdmaPowerState = SdmaPowerState::Down;
+    }
+    IOLockUnlock(that->sdmaPowerLock);
+}
+
 void X5000HWLibs::wrapUpdateSdmaPowerGating(void *cail, uint32_t mode) {
     FunctionCast(wrapUpdateSdmaPowerGating, callback->orgUpdateSdmaPowerGating)(cail, mode);
     switch (mode) {
         case 0:
-            [[fallthrough]];
+            // After hardware (re)initialisation the SMU may not be in the state we last left it in.
+            callback->powerUpSdma(true);
+            break;
         case 3:
-            NRed::callback->sendMsgToSmc(PPSMC_MSG_PowerUpSdma);
+            callback->powerUpSdma(false);
             break;
         case 2:
-            NRed::callback->sendMsgToSmc(PPSMC_MSG_PowerDownSdma);
+            callback->requestSdmaPowerDown();
             break;
         default:
             break;
@@ -162,7 +221,7 @@ void X5000HWLibs::wrapUpdateSdmaPowerGating(void *cail, uint32_t mode) {
 
 CAILResult X5000HWLibs::wrapPspCmdKmSubmit(void *psp, void *ctx, void *param3, void *param4) {
     // Upstream patch: https://github.com/torvalds/linux/commit/f8f70c1371d304f42d4a1242d8abcbda807d0bed
-    if (NRed::callback->chipType >= ChipType::Renoir && getMember<uint32_t>(ctx, 0x10) == 6) {
+    if (NRed::callback->chipProfile->gfx93 && getMember<uint32_t>(ctx, 0x10) == 6) {
         DBGLOG("hwlibs", "Skipping MEC2 JT FW");
         return kCAILResultSuccess;
     }
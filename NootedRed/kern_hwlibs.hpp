@@ -5,10 +5,20 @@
 #include "kern_amd.hpp"
 #include <Headers/kern_patcher.hpp>
 #include <Headers/kern_util.hpp>
+#include <kern/thread_call.h>
 
 using t_createFirmware = void *(*)(const void *data, uint32_t size, uint32_t ipVersion, const char *filename);
 using t_putFirmware = bool (*)(void *that, uint32_t deviceType, void *fw);
 
+/** How long SDMA has to stay idle before it is powered down; `nredsdmapgdelay=<ms>` overrides it, 0 disables it. */
+constexpr uint32_t SDMA_POWER_DOWN_DELAY_MSEC = 50;
+
+enum struct SdmaPowerState : uint32_t {
+    Unknown = 0,
+    Up,
+    Down,
+};
+
 class X5000HWLibs {
     public:
     static X5000HWLibs *callback;
@@ -21,7 +31,15 @@ class X5000HWLibs {
     t_putFirmware orgPutFirmware {nullptr};
     mach_vm_address_t orgUpdateSdmaPowerGating {0};
     mach_vm_address_t orgPspCmdKmSubmit {0};
+    IOLock *sdmaPowerLock {nullptr};
+    thread_call_t sdmaPowerDownCall {nullptr};
+    uint64_t sdmaPowerDownDelay {0};
+    SdmaPowerState sdmaPowerState {SdmaPowerState::Unknown};
+    bool sdmaPowerDownPending {false};
 
+    void powerUpSdma(bool force);
+    void requestSdmaPowerDown();
+    static void processSdmaPowerDown(thread_call_param_t param0, thread_call_param_t param1);
     static void wrapPopulateFirmwareDirectory(void *that);
     static void wrapUpdateSdmaPowerGating(void *cail, uint32_t mode);
     static CAILResult wrapPspCmdKmSubmit(void *psp, void *ctx, void *param3, void *param4);
@@ -9,12 +9,47 @@ struct Model {
     const char *name {nullptr};
 };
 
+/** Revision to 1-based index into a model list, or 0 if there's no model for it. */
+struct RevisionIndex {
+    uint8_t index[256] {};
+
+    template<size_t N>
+    constexpr RevisionIndex(const Model (&models)[N]) {
+        for (size_t i = 0; i < N; i++) { index[models[i].revision & 0xFF] = static_cast<uint8_t>(i + 1); }
+    }
+};
+
 struct DevicePair {
     uint16_t deviceId;
     const Model *models;
-    size_t count;
+    const RevisionIndex *revisions;
 };
 
+static constexpr char brandingPrefix[] = "AMD Radeon ";
+/** Where `ATY,DeviceName` starts in a marketing name, e.g. `Vega 8` in `AMD Radeon Vega 8`. */
+static constexpr size_t BRANDING_DEVICE_NAME_OFF = arrsize(brandingPrefix) - 1;
+static constexpr const char *defaultBranding = "AMD Radeon Graphics";
+
+static constexpr bool hasBrandingPrefix(const char *name) {
+    for (size_t i = 0; i < BRANDING_DEVICE_NAME_OFF; i++) {
+        if (name[i] != brandingPrefix[i]) { return false; }
+    }
+    return true;
+}
+
+/** Every name must carry the prefix, and every revision must fit the index exactly once. */
+template<size_t N>
+static constexpr bool modelsAreValid(const Model (&models)[N]) {
+    if (N > 0xFF) { return false; }
+    for (size_t i = 0; i < N; i++) {
+        if (models[i].revision > 0xFF || !hasBrandingPrefix(models[i].name)) { return false; }
+        for (size_t j = 0; j < i; j++) {
+            if (models[j].revision == models[i].revision) { return false; }
+        }
+    }
+    return true;
+}
+
 static constexpr Model dev15DD[] = {
     {0x81, "AMD Radeon Vega 11"},
     {0x82, "AMD Radeon Vega 8"},
@@ -91,21 +126,32 @@ static constexpr Model dev15D8[] = {
     {0xE4, "AMD Radeon Vega 3"},
 };
 
+static_assert(modelsAreValid(dev15DD));
+static_assert(modelsAreValid(dev15D8));
+static_assert(hasBrandingPrefix(defaultBranding));
+
+static constexpr RevisionIndex dev15DDRevisions {dev15DD};
+static constexpr RevisionIndex dev15D8Revisions {dev15D8};
+
+/** Renoir, Lucienne, Cezanne and Barcelo are all marketed as `AMD Radeon Graphics`, whatever the revision. */
 static constexpr DevicePair devices[] = {
-    {0x15DD, dev15DD, arrsize(dev15DD)},
-    {0x15D8, dev15D8, arrsize(dev15D8)},
+    {0x15DD, dev15DD, &dev15DDRevisions},
+    {0x15D8, dev15D8, &dev15D8Revisions},
+    {0x1636, nullptr, nullptr},
+    {0x164C, nullptr, nullptr},
+    {0x1638, nullptr, nullptr},
+    {0x15E7, nullptr, nullptr},
 };
 
 inline const char *getBranding(uint16_t dev, uint16_t rev) {
     for (auto &device : devices) {
-        if (device.deviceId == dev) {
-            for (size_t i = 0; i < device.count; i++) {
-                auto &model = device.models[i];
-                if (model.revision == rev) { return model.name; }
-            }
-            break;
+        if (device.deviceId != dev) { continue; }
+        if (device.revisions && rev <= 0xFF) {
+            auto i = device.revisions->index[rev];
+            if (i) { return device.models[i - 1].name; }
         }
+        break;
     }
 
-    return "AMD Radeon Graphics";
+    return defaultBranding;
 }
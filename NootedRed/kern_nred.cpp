@@ -37,6 +37,15 @@ void NRed::init() {
     SYSLOG("nred", "Copyright 2022-2023 ChefKiss Inc. If you've paid for this, you've been scammed.");
     callback = this;
 
+    this->regLock = IOSimpleLockAlloc();
+    PANIC_COND(!this->regLock, "nred", "Failed to allocate register lock");
+    this->smuLock = IOLockAlloc();
+    PANIC_COND(!this->smuLock, "nred", "Failed to allocate SMU lock");
+    this->smuStatsLock = IOSimpleLockAlloc();
+    PANIC_COND(!this->smuStatsLock, "nred", "Failed to allocate SMU stats lock");
+    this->smuQueueCall = thread_call_allocate(processSMUQueue, this);
+    PANIC_COND(!this->smuQueueCall, "nred", "Failed to allocate SMU queue thread call");
+
     lilu.onKextLoadForce(&kextAGDP);
     lilu.onKextLoadForce(&kextBacklight);
     lilu.onKextLoadForce(&kextMCCSControl);
@@ -48,6 +57,10 @@ void NRed::init() {
 
     lilu.onPatcherLoadForce(
         [](void *user, KernelPatcher &patcher) { static_cast<NRed *>(user)->processPatcher(patcher); }, this);
+    /**
+     * Lilu only invokes this for kexts registered through `onKextLoad`, once each, and assigns `loadIndex` as they
+     * load, so the comparison chain in `processKext` is already the cheapest dispatch available.
+     */
     lilu.onKextLoadForce(
         nullptr, 0,
         [](void *user, KernelPatcher &patcher, size_t index, mach_vm_address_t address, size_t size) {
@@ -102,7 +115,8 @@ void NRed::processPatcher(KernelPatcher &patcher) {
             auto len = static_cast<uint32_t>(strlen(model) + 1);
             this->iGPU->setProperty("model", const_cast<char *>(model), len);
             this->iGPU->setProperty("ATY,FamilyName", const_cast<char *>("Radeon"), 7);
-            this->iGPU->setProperty("ATY,DeviceName", const_cast<char *>(model) + 11, len - 11);    // Vega ...
+            this->iGPU->setProperty("ATY,DeviceName", const_cast<char *>(model) + BRANDING_DEVICE_NAME_OFF,
+                len - static_cast<uint32_t>(BRANDING_DEVICE_NAME_OFF));    // Vega ...
         }
 
         auto *prop = OSDynamicCast(OSData, this->iGPU->getProperty("ATY,bin_image"));
@@ -110,6 +124,8 @@ void NRed::processPatcher(KernelPatcher &patcher) {
             DBGLOG("nred", "VBIOS manually overridden");
             this->vbiosData = OSData::withBytes(prop->getBytesNoCopy(), prop->getLength());
             PANIC_COND(UNLIKELY(!this->vbiosData), "nred", "Failed to allocate VBIOS data");
+            // The framebuffer must see our fixed up copy.
+            this->iGPU->setProperty("ATY,bin_image", this->vbiosData);
         } else if (UNLIKELY(!this->getVBIOSFromVFCT(this->iGPU))) {
             SYSLOG("nred", "Failed to get VBIOS from VFCT.");
             PANIC_COND(UNLIKELY(!this->getVBIOSFromVRAM(this->iGPU)), "nred", "Failed to get VBIOS from VRAM");
@@ -119,6 +135,8 @@ void NRed::processPatcher(KernelPatcher &patcher) {
             DBGLOG("nred", "Padding VBIOS to 65536 bytes (was %u)", len);
             this->vbiosData->appendByte(0, 65536 - len);
         }
+        this->processVBIOSConnectors();
+        this->processVBIOSVramInfo();
 
         DeviceInfo::deleter(devInfo);
     } else {
@@ -133,21 +151,317 @@ void NRed::processPatcher(KernelPatcher &patcher) {
     dyldpatches.processPatcher(patcher);
 }
 
+static void setNumber(OSDictionary *dict, const char *key, uint64_t value) {
+    auto *num = OSNumber::withNumber(value, 64);
+    if (num) {
+        dict->setObject(key, num);
+        num->release();
+    }
+}
+
+/**
+ * Drop display paths with an invalid device tag from the VBIOS display object table, before the framebuffer reads it.
+ * The outcome is published as `VBIOSConnectors` on the iGPU.
+ */
+void NRed::processVBIOSConnectors() {
+    auto *objInfo = this->getVBIOSDataTable<DispObjInfoTableV1_4>(0x16);
+    if (!objInfo) {
+        DBGLOG("nred", "No display object info table in VBIOS");
+        return;
+    }
+    if (objInfo->formatRev != 1 || (objInfo->contentRev != 4 && objInfo->contentRev != 5)) {
+        DBGLOG("nred", "Unsupported display object info table v%u.%u", objInfo->formatRev, objInfo->contentRev);
+        return;
+    }
+
+    // Never trust `pathCount` beyond what the table or the VBIOS image can hold
+    auto vbiosEnd = reinterpret_cast<uintptr_t>(this->vbiosData->getBytesNoCopy()) + this->vbiosData->getLength();
+    auto tableEnd = reinterpret_cast<uintptr_t>(objInfo) + objInfo->structureSize;
+    if (tableEnd > vbiosEnd) { tableEnd = vbiosEnd; }
+    auto pathsStart = reinterpret_cast<uintptr_t>(objInfo->paths);
+    size_t capacity = tableEnd > pathsStart ? (tableEnd - pathsStart) / sizeof(ATOMDispObjPathV2) : 0;
+    size_t n = objInfo->pathCount;
+    if (n > capacity) {
+        SYSLOG("nred", "VBIOS claims %zu display paths, but only %zu fit in the table", n, capacity);
+        n = capacity;
+    }
+
+    auto *dropped = OSArray::withCapacity(static_cast<uint32_t>(n));
+    size_t j = 0;
+    for (size_t i = 0; i < n; i++) {
+        // Skip invalid device tags
+        if (objInfo->paths[i].devTag) {
+            objInfo->paths[j++] = objInfo->paths[i];
+            continue;
+        }
+        DBGLOG("nred", "Dropping display path %zu (object 0x%X)", i, objInfo->paths[i].dispObjId);
+        if (dropped) {
+            auto *num = OSNumber::withNumber(objInfo->paths[i].dispObjId, 16);
+            if (num) {
+                dropped->setObject(num);
+                num->release();
+            }
+        }
+    }
+    objInfo->pathCount = static_cast<uint8_t>(j);
+    DBGLOG("nred", "VBIOS display paths: %zu kept, %zu dropped", j, n - j);
+
+    auto *report = OSDictionary::withCapacity(2);
+    if (report) {
+        setNumber(report, "PathCount", j);
+        if (dropped) { report->setObject("DroppedObjects", dropped); }
+        this->iGPU->setProperty("VBIOSConnectors", report);
+        report->release();
+    }
+    OSSafeReleaseNULL(dropped);
+}
+
+struct VRAMTypeInfo {
+    uint8_t memoryType;          // DMI type 17 memory type
+    uint32_t videoMemoryType;    // What we report to AMD's kexts
+    uint32_t channelWidth;       // Bits per UMA channel
+    uint32_t transferRate;       // Nominal MT/s, only set for types AMD's kexts don't know about
+};
+
+struct VRAMLayout {
+    uint32_t videoMemoryType;
+    uint32_t width;
+};
+
+/** The data rate AMD's kexts assume for `kVideoMemoryTypeDDR4`. */
+constexpr uint32_t VRAM_DDR4_TRANSFER_RATE = 3200;
+
+static constexpr VRAMTypeInfo vramTypes[] = {
+    {kDDR2MemType, kVideoMemoryTypeDDR2, 64, 0},
+    {kDDR2FBDIMMMemType, kVideoMemoryTypeDDR2, 64, 0},
+    {kLPDDR2MemType, kVideoMemoryTypeDDR2, 64, 0},
+    {kDDR3MemType, kVideoMemoryTypeDDR3, 64, 0},
+    {kLPDDR3MemType, kVideoMemoryTypeDDR3, 64, 0},
+    {kDDR4MemType, kVideoMemoryTypeDDR4, 64, 0},
+    {kLPDDR4MemType, kVideoMemoryTypeDDR4, 64, 0},
+    // AMD's kexts don't know about DDR5, so report the DDR4 width with equivalent bandwidth.
+    // Like Linux, LPDDR5 UMA channels are 32 bits wide while DDR5 keeps 64-bit channels.
+    {kDDR5MemType, kVideoMemoryTypeDDR4, 64, 4800},
+    {kLPDDR5MemType, kVideoMemoryTypeDDR4, 32, 6400},
+};
+
+/**
+ * `legacy` reports (LP)DDR5 like older releases did: DDR4 with 64-bit channels.
+ */
+static constexpr VRAMLayout getVRAMLayout(uint8_t memoryType, uint32_t channelCount, bool legacy) {
+    for (const auto &info : vramTypes) {
+        if (info.memoryType != memoryType) { continue; }
+        if (legacy) { return {info.videoMemoryType, channelCount * 64}; }
+        if (!info.transferRate) { return {info.videoMemoryType, channelCount * info.channelWidth}; }
+        return {info.videoMemoryType, channelCount * info.channelWidth * info.transferRate / VRAM_DDR4_TRANSFER_RATE};
+    }
+    return {kVideoMemoryTypeUnknown, channelCount * 64};
+}
+
+static_assert(getVRAMLayout(kDDR4MemType, 2, false).videoMemoryType == kVideoMemoryTypeDDR4 &&
+              getVRAMLayout(kDDR4MemType, 2, false).width == 128);
+static_assert(getVRAMLayout(kDDR3MemType, 1, false).videoMemoryType == kVideoMemoryTypeDDR3);
+static_assert(getVRAMLayout(kDDR2MemType, 2, false).width == 128);
+static_assert(getVRAMLayout(kDDR3MemType, 2, false).width == 128);
+static_assert(getVRAMLayout(kLPDDR3MemType, 2, false).width == 128);
+static_assert(getVRAMLayout(kDDR4MemType, 4, false).width == 256);
+static_assert(getVRAMLayout(kLPDDR4MemType, 4, false).width == 256);
+static_assert(getVRAMLayout(kDDR5MemType, 2, false).videoMemoryType == kVideoMemoryTypeDDR4 &&
+              getVRAMLayout(kDDR5MemType, 2, false).width == 192);
+static_assert(getVRAMLayout(kDDR5MemType, 4, false).width == 384);
+static_assert(getVRAMLayout(kLPDDR5MemType, 4, false).width == 256);
+static_assert(getVRAMLayout(kLPDDR5MemType, 8, false).width == 512);
+static_assert(getVRAMLayout(kLPDDR5MemType, 8, true).width == 512 && getVRAMLayout(kDDR5MemType, 4, true).width == 256);
+static_assert(getVRAMLayout(0, 1, false).videoMemoryType == kVideoMemoryTypeUnknown &&
+              getVRAMLayout(0, 1, false).width == 64);
+
+/**
+ * Decode the VRAM type and width from the iGPU System Info table once, for `populateVramInfo`.
+ * The outcome is published as `VRAMInfo` on the iGPU.
+ */
+void NRed::processVBIOSVramInfo() {
+    uint32_t channelCount = 1;
+    auto *table = this->getVBIOSDataTable<IGPSystemInfo>(0x1E);
+    uint8_t memoryType = 0;
+    if (table) {
+        DBGLOG("nred", "Fetching VRAM info from iGPU System Info");
+        switch (table->header.formatRev) {
+            case 1:
+                switch (table->header.contentRev) {
+                    case 11:
+                        [[fallthrough]];
+                    case 12:
+                        if (table->infoV11.umaChannelCount) { channelCount = table->infoV11.umaChannelCount; }
+                        memoryType = table->infoV11.memoryType;
+                        break;
+                    default:
+                        DBGLOG("nred", "Unsupported contentRev %d", table->header.contentRev);
+                        break;
+                }
+                break;
+            case 2:
+                switch (table->header.contentRev) {
+                    case 1:
+                        [[fallthrough]];
+                    case 2:
+                        if (table->infoV2.umaChannelCount) { channelCount = table->infoV2.umaChannelCount; }
+                        memoryType = table->infoV2.memoryType;
+                        break;
+                    default:
+                        DBGLOG("nred", "Unsupported contentRev %d", table->header.contentRev);
+                        break;
+                }
+                break;
+            default:
+                DBGLOG("nred", "Unsupported formatRev %d", table->header.formatRev);
+                break;
+        }
+    } else {
+        DBGLOG("nred", "No iGPU System Info in Master Data Table");
+    }
+    auto layout = getVRAMLayout(memoryType, channelCount, checkKernelArgument("-nredvramlegacy"));
+    this->videoMemoryType = layout.videoMemoryType;
+    this->vramWidth = layout.width;
+    DBGLOG_COND(layout.videoMemoryType == kVideoMemoryTypeUnknown, "nred", "Unsupported memory type %d", memoryType);
+    DBGLOG("nred", "VRAM: memory type 0x%X, %u channels, video memory type %u, width %u", memoryType, channelCount,
+        this->videoMemoryType, this->vramWidth);
+
+    auto *report = OSDictionary::withCapacity(4);
+    if (report) {
+        setNumber(report, "MemoryType", memoryType);
+        setNumber(report, "ChannelCount", channelCount);
+        setNumber(report, "VideoMemoryType", this->videoMemoryType);
+        setNumber(report, "Width", this->vramWidth);
+        this->iGPU->setProperty("VRAMInfo", report);
+        report->release();
+    }
+}
+
+/**
+ * Build the X5000 <-> X6000 metaclass remap table once both kexts have had their metaclasses solved.
+ * The address range is published last, so `getMetaClassRemap` rejects everything until the table is complete.
+ */
+void NRed::buildMetaClassRemap() {
+    if (this->metaClassRangeEnd) { return; }
+    for (const auto &ent : this->metaClassMap) {
+        if (!ent[0] || !ent[1]) { return; }
+    }
+
+    auto start = UINTPTR_MAX, end = static_cast<uintptr_t>(0);
+    auto insert = [&](const OSMetaClass *from, const OSMetaClass *to) {
+        auto i = hashMetaClass(from, META_CLASS_REMAP_BITS);
+        while (this->metaClassRemap[i].from) { i = (i + 1) % META_CLASS_REMAP_SLOTS; }
+        this->metaClassRemap[i] = {from, to};
+        auto addr = reinterpret_cast<uintptr_t>(from);
+        if (addr < start) { start = addr; }
+        if (addr > end) { end = addr; }
+    };
+    for (const auto &ent : this->metaClassMap) {
+        insert(ent[0], ent[1]);
+        insert(ent[1], ent[0]);
+    }
+
+    this->metaClassRangeStart = start;
+    __atomic_store_n(&this->metaClassRangeEnd, end, __ATOMIC_RELEASE);
+    DBGLOG("nred", "Metaclass remap table built (0x%lX - 0x%lX)", start, end);
+}
+
+/**
+ * Whether `meta` or any of its superclasses is one of the remapped accelerator classes.
+ * Entries store the metaclass pointer with the answer in bit 0, so a slot is read and written atomically.
+ */
+bool NRed::hasRemappedAncestor(const OSMetaClass *meta) {
+    auto key = reinterpret_cast<uintptr_t>(meta);
+    auto &slot = this->metaClassAncestry[hashMetaClass(meta, META_CLASS_ANCESTRY_BITS)];
+    auto cached = __atomic_load_n(&slot, __ATOMIC_RELAXED);
+    if (LIKELY((cached & ~static_cast<uintptr_t>(1)) == key)) { return cached & 1; }
+
+    auto found = false;
+    for (auto *cur = meta; cur && !found; cur = cur->getSuperClass()) { found = this->getMetaClassRemap(cur); }
+    __atomic_store_n(&slot, key | found, __ATOMIC_RELAXED);
+    return found;
+}
+
+/**
+ * Casts to anything but the remapped accelerator classes go straight through to the original.
+ * For those, the cast is only retried with the counterpart class when the object can actually be one.
+ */
 OSMetaClassBase *NRed::wrapSafeMetaCast(const OSMetaClassBase *anObject, const OSMetaClass *toMeta) {
+    auto *remap = callback->getMetaClassRemap(toMeta);
+    if (LIKELY(!remap)) { return FunctionCast(wrapSafeMetaCast, callback->orgSafeMetaCast)(anObject, toMeta); }
+
     auto ret = FunctionCast(wrapSafeMetaCast, callback->orgSafeMetaCast)(anObject, toMeta);
-    if (UNLIKELY(!ret)) {
-        for (const auto &ent : callback->metaClassMap) {
-            if (LIKELY(ent[0] == toMeta)) {
-                return FunctionCast(wrapSafeMetaCast, callback->orgSafeMetaCast)(anObject, ent[1]);
-            } else if (UNLIKELY(ent[1] == toMeta)) {
-                return FunctionCast(wrapSafeMetaCast, callback->orgSafeMetaCast)(anObject, ent[0]);
-            }
+    if (ret || !anObject || !callback->hasRemappedAncestor(anObject->getMetaClass())) { return ret; }
+    return FunctionCast(wrapSafeMetaCast, callback->orgSafeMetaCast)(anObject, remap);
+}
+
+struct ChipDevice {
+    uint16_t deviceId;
+    uint16_t minRevision, maxRevision;    // Inclusive range of the revision from `0xD2F`
+    ChipType chipType;
+    uint16_t enumRevision;
+};
+
+/** Sorted by device ID, then revision. */
+static constexpr ChipDevice chipDevices[] = {
+    {0x15D8, 0x0, 0x7, ChipType::Picasso, 0x41},
+    {0x15D8, 0x8, 0xF, ChipType::Raven2, 0x79},
+    {0x15DD, 0x0, 0x7, ChipType::Raven, 0x10},
+    {0x15DD, 0x8, 0xF, ChipType::Raven2, 0x79},
+    {0x15E7, 0x0, 0xF, ChipType::GreenSardine, 0xA1},
+    {0x1636, 0x0, 0xF, ChipType::Renoir, 0x91},
+    {0x1638, 0x0, 0xF, ChipType::GreenSardine, 0xA1},
+    {0x164C, 0x0, 0xF, ChipType::Renoir, 0x91},
+};
+
+static constexpr const ChipDevice *findChipDevice(uint32_t deviceId, uint32_t revision) {
+    size_t lo = 0, hi = arrsize(chipDevices);
+    while (lo < hi) {
+        auto mid = lo + (hi - lo) / 2;
+        if (chipDevices[mid].deviceId < deviceId) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
         }
     }
-    return ret;
+    for (; lo < arrsize(chipDevices) && chipDevices[lo].deviceId == deviceId; lo++) {
+        if (revision >= chipDevices[lo].minRevision && revision <= chipDevices[lo].maxRevision) {
+            return &chipDevices[lo];
+        }
+    }
+    return nullptr;
 }
 
-void NRed::setRMMIOIfNecessary() {
+static constexpr bool chipDevicesAreSorted() {
+    for (size_t i = 1; i < arrsize(chipDevices); i++) {
+        auto &prev = chipDevices[i - 1], &cur = chipDevices[i];
+        if (prev.deviceId > cur.deviceId || (prev.deviceId == cur.deviceId && prev.maxRevision >= cur.minRevision)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static constexpr ChipType findChipType(uint32_t deviceId, uint32_t revision) {
+    auto *device = findChipDevice(deviceId, revision);
+    return device ? device->chipType : ChipType::Unknown;
+}
+
+static_assert(chipDevicesAreSorted(), "chipDevices must be sorted without overlapping revisions");
+static_assert(findChipType(0x15D8, 0x0) == ChipType::Picasso && findChipType(0x15D8, 0x8) == ChipType::Raven2);
+static_assert(findChipType(0x15DD, 0x7) == ChipType::Raven && findChipType(0x15DD, 0xF) == ChipType::Raven2);
+static_assert(findChipType(0x1636, 0x0) == ChipType::Renoir && findChipType(0x164C, 0x1) == ChipType::Renoir);
+static_assert(findChipType(0x15E7, 0x0) == ChipType::GreenSardine);
+static_assert(findChipType(0x1638, 0x0) == ChipType::GreenSardine);
+static_assert(findChipType(0x15D9, 0x0) == ChipType::Unknown && findChipType(0x1681, 0x0) == ChipType::Unknown);
+static_assert(chipProfiles[static_cast<size_t>(findChipType(0x15D8, 0x0))].gpuInfoFirmware[0] == 'p');
+static_assert(chipProfiles[static_cast<size_t>(findChipType(0x1638, 0x0))].vcn2);
+
+/**
+ * Maps RMMIO and identifies the chip on first use.
+ * Returns false for chips we don't know, in which case callers must leave AMD's kexts alone.
+ */
+bool NRed::setRMMIOIfNecessary() {
     if (UNLIKELY(!this->rmmio || !this->rmmio->getLength())) {
         this->rmmio = this->iGPU->mapDeviceMemoryWithRegister(kIOPCIConfigBaseAddress5);
         PANIC_COND(UNLIKELY(!this->rmmio || !this->rmmio->getLength()), "nred", "Failed to map RMMIO");
@@ -155,41 +469,203 @@ void NRed::setRMMIOIfNecessary() {
 
         this->fbOffset = static_cast<uint64_t>(this->readReg32(0x296B)) << 24;
         this->revision = (this->readReg32(0xD2F) & 0xF000000) >> 0x18;
-        switch (this->deviceId) {
-            case 0x15D8:
-                if (LIKELY(this->revision >= 0x8)) {
-                    this->chipType = ChipType::Raven2;
-                    this->enumRevision = 0x79;
-                    break;
-                }
-                this->chipType = ChipType::Picasso;
-                this->enumRevision = 0x41;
-                break;
-            case 0x15DD:
-                if (LIKELY(this->revision >= 0x8)) {
-                    this->chipType = ChipType::Raven2;
-                    this->enumRevision = 0x79;
-                    break;
-                }
-                this->chipType = ChipType::Raven;
-                this->enumRevision = 0x10;
-                break;
-            case 0x164C:
-                [[fallthrough]];
-            case 0x1636:
-                this->chipType = ChipType::Renoir;
-                this->enumRevision = 0x91;
-                break;
-            case 0x15E7:
-                [[fallthrough]];
-            case 0x1638:
-                this->chipType = ChipType::GreenSardine;
-                this->enumRevision = 0xA1;
-                break;
-            default:
-                PANIC("nred", "Unknown device ID");
+        auto *device = findChipDevice(this->deviceId, this->revision);
+        if (UNLIKELY(!device)) {
+            SYSLOG("nred", "Unknown device 0x%X revision 0x%X, not patching AMD kexts", this->deviceId,
+                this->revision);
+            return false;
+        }
+        this->chipType = device->chipType;
+        this->enumRevision = device->enumRevision;
+        this->chipProfile = &chipProfiles[static_cast<size_t>(this->chipType)];
+    }
+    return this->chipType != ChipType::Unknown;
+}
+
+CAILResult NRed::waitForSMUResp(uint32_t &resp, size_t &bucket) {
+    auto start = mach_absolute_time();
+    uint64_t spinEnd = 0, deadline = 0;
+    nanoseconds_to_absolutetime(SMU_POLL_SPIN_USEC * 1000ULL, &spinEnd);
+    nanoseconds_to_absolutetime(SMU_RESP_TIMEOUT_MSEC * 1000000ULL, &deadline);
+    spinEnd += start;
+    deadline += start;
+    auto ret = kCAILResultGeneralFailure;
+    while (true) {
+        resp = this->readReg32(MP_BASE + mmMP1_SMN_C2PMSG_90);
+        if (resp) {
+            ret = resp == PP_RESULT_OK ? kCAILResultSuccess : kCAILResultGeneralFailure;
+            break;
+        }
+
+        auto now = mach_absolute_time();
+        if (now >= deadline) { break; }
+        if (now < spinEnd) {
+            IODelay(1);
+        } else {
+            IOSleep(1);
+        }
+    }
+
+    uint64_t ns = 0;
+    absolutetime_to_nanoseconds(mach_absolute_time() - start, &ns);
+    bucket = 0;
+    for (auto us = ns / 1000; us > 1 && bucket < SMU_LATENCY_BUCKETS - 1; us >>= 1) { bucket++; }
+
+    return ret;
+}
+
+/**
+ * The stats have their own lock, so reading them never waits on the up to two SMU waits `smuLock` is held across.
+ */
+void NRed::recordSMUWait(SMUMsgStats &stats, uint32_t *latency, size_t bucket, uint32_t resp) {
+    IOSimpleLockLock(this->smuStatsLock);
+    latency[bucket]++;
+    if (!resp) { stats.timeouts++; }
+    stats.lastResp = resp;
+    IOSimpleLockUnlock(this->smuStatsLock);
+}
+
+CAILResult NRed::sendMsgToSmcLocked(uint32_t msg, uint32_t param, uint32_t *outParam) {
+    static SMUMsgStats untracked {};
+    auto &stats = msg < SMU_STATS_MSG_COUNT ? this->smuStats[msg] : untracked;
+    IOSimpleLockLock(this->smuStatsLock);
+    stats.count++;
+    IOSimpleLockUnlock(this->smuStatsLock);
+
+    uint32_t resp = 0;
+    size_t bucket = 0;
+    auto ret = this->waitForSMUResp(resp, bucket);
+    this->recordSMUWait(stats, stats.preCheckLatency, bucket, resp);
+    if (ret != kCAILResultSuccess) {
+        SYSLOG("nred", "SMU msg 0x%X pre-check failed (resp 0x%X); SMU may be in an improper state", msg, resp);
+        return kCAILResultGeneralFailure;
+    }
+
+    this->writeReg32(MP_BASE + mmMP1_SMN_C2PMSG_90, 0);
+    this->writeReg32(MP_BASE + mmMP1_SMN_C2PMSG_82, param);
+    this->writeReg32(MP_BASE + mmMP1_SMN_C2PMSG_66, msg);
+
+    ret = this->waitForSMUResp(resp, bucket);
+    this->recordSMUWait(stats, stats.respLatency, bucket, resp);
+    if (ret != kCAILResultSuccess) {
+        SYSLOG("nred", "SMU msg 0x%X failed (resp 0x%X)", msg, resp);
+        return ret;
+    }
+
+    if (outParam) { *outParam = this->readReg32(MP_BASE + mmMP1_SMN_C2PMSG_82); }
+    return kCAILResultSuccess;
+}
+
+/**
+ * Failures are logged by `sendMsgToSmcLocked`; nothing queued needs the result.
+ */
+size_t NRed::drainSMUQueueLocked(size_t limit) {
+    size_t count = 0;
+    while (this->smuQueueCount && count < limit) {
+        auto &entry = this->smuQueue[this->smuQueueHead];
+        this->smuQueueHead = (this->smuQueueHead + 1) % SMU_QUEUE_SIZE;
+        this->smuQueueCount--;
+        this->sendMsgToSmcLocked(entry.msg, entry.param, nullptr);
+        count++;
+    }
+    return count;
+}
+
+/**
+ * Synchronously issue an SMU message.
+ * Anything still queued is issued first so ordering is preserved.
+ */
+CAILResult NRed::sendMsgToSmc(uint32_t msg, uint32_t param, uint32_t *outParam) {
+    IOLockLock(this->smuLock);
+    this->drainSMUQueueLocked();
+    auto ret = this->sendMsgToSmcLocked(msg, param, outParam);
+    IOLockUnlock(this->smuLock);
+    return ret;
+}
+
+/**
+ * Queue an SMU message to be issued from a thread call so the caller does not wait on the SMU.
+ * Callers coalesce redundant messages themselves, as `X5000HWLibs` does for SDMA power gating.
+ */
+void NRed::queueMsgToSmc(uint32_t msg, uint32_t param) {
+    IOLockLock(this->smuLock);
+    if (this->smuQueueCount == SMU_QUEUE_SIZE) {
+        DBGLOG("nred", "SMU queue full, issuing msg 0x%X synchronously", msg);
+        this->drainSMUQueueLocked();
+        this->sendMsgToSmcLocked(msg, param, nullptr);
+    } else {
+        this->smuQueue[(this->smuQueueHead + this->smuQueueCount) % SMU_QUEUE_SIZE] = {msg, param};
+        this->smuQueueCount++;
+        thread_call_enter(this->smuQueueCall);
+    }
+    IOLockUnlock(this->smuLock);
+}
+
+/**
+ * The lock is dropped between messages, so a synchronous sender only ever waits for the one in flight.
+ */
+void NRed::processSMUQueue(thread_call_param_t param0, thread_call_param_t) {
+    auto *that = static_cast<NRed *>(param0);
+    size_t count;
+    do {
+        IOLockLock(that->smuLock);
+        count = that->drainSMUQueueLocked(1);
+        IOLockUnlock(that->smuLock);
+    } while (count);
+}
+
+static OSArray *copyLatencyHistogram(const uint32_t *buckets) {
+    auto *array = OSArray::withCapacity(SMU_LATENCY_BUCKETS);
+    if (!array) { return nullptr; }
+    for (size_t i = 0; i < SMU_LATENCY_BUCKETS; i++) {
+        auto *num = OSNumber::withNumber(buckets[i], 32);
+        if (num) {
+            array->setObject(num);
+            num->release();
         }
     }
+    return array;
+}
+
+/**
+ * Snapshot of the per-message SMU statistics, keyed by message ID.
+ * Histogram bucket `n` counts waits of roughly 2^n microseconds.
+ */
+OSDictionary *NRed::copySMUStats() {
+    auto *dict = OSDictionary::withCapacity(4);
+    if (!dict) { return nullptr; }
+
+    // One message at a time, as this runs deep in an IOKit call chain where the whole table won't fit on the stack.
+    SMUMsgStats entry;
+    for (uint32_t msg = 0; msg < SMU_STATS_MSG_COUNT; msg++) {
+        IOSimpleLockLock(this->smuStatsLock);
+        entry = this->smuStats[msg];
+        IOSimpleLockUnlock(this->smuStatsLock);
+        if (!entry.count) { continue; }
+
+        auto *msgDict = OSDictionary::withCapacity(5);
+        if (!msgDict) { continue; }
+        setNumber(msgDict, "Count", entry.count);
+        setNumber(msgDict, "Timeouts", entry.timeouts);
+        setNumber(msgDict, "LastResponse", entry.lastResp);
+        auto *hist = copyLatencyHistogram(entry.preCheckLatency);
+        if (hist) {
+            msgDict->setObject("PreCheckLatency", hist);
+            hist->release();
+        }
+        hist = copyLatencyHistogram(entry.respLatency);
+        if (hist) {
+            msgDict->setObject("ResponseLatency", hist);
+            hist->release();
+        }
+
+        char key[8];
+        snprintf(key, arrsize(key), "0x%02X", msg);
+        dict->setObject(key, msgDict);
+        msgDict->release();
+    }
+
+    return dict;
 }
 
 void NRed::processKext(KernelPatcher &patcher, size_t index, mach_vm_address_t address, size_t size) {
@@ -235,7 +711,7 @@ struct ApplePanelData {
     uint8_t deviceData[36];
 };
 
-static ApplePanelData appleBacklightData[] = {
+static const ApplePanelData appleBacklightData[] = {
     {"F14Txxxx", {0x00, 0x11, 0x00, 0x00, 0x00, 0x34, 0x00, 0x52, 0x00, 0x73, 0x00, 0x94, 0x00, 0xBE, 0x00, 0xFA, 0x01,
                      0x36, 0x01, 0x72, 0x01, 0xC5, 0x02, 0x2F, 0x02, 0xB9, 0x03, 0x60, 0x04, 0x1A, 0x05, 0x0A, 0x06,
                      0x0E, 0x07, 0x10}},
@@ -263,27 +739,28 @@ size_t NRed::wrapFunctionReturnZero() { return 0; }
 
 bool NRed::wrapApplePanelSetDisplay(IOService *that, IODisplay *display) {
     static bool once = false;
-    if (!once) {
-        once = true;
+    if (!__atomic_exchange_n(&once, true, __ATOMIC_ACQ_REL)) {
         auto *panels = OSDynamicCast(OSDictionary, that->getProperty("ApplePanels"));
         if (panels) {
-            auto *rawPanels = panels->copyCollection();
-            panels = OSDynamicCast(OSDictionary, rawPanels);
-
+            // The panel curves are plain OSData, so a shallow copy is enough; reserve room for our entries upfront.
+            panels = OSDictionary::withDictionary(panels, panels->getCount() + arrsize(appleBacklightData));
             if (panels) {
                 for (auto &entry : appleBacklightData) {
-                    auto pd = OSData::withBytes(entry.deviceData, sizeof(entry.deviceData));
+                    // The curves live in constant storage for the lifetime of the kext, so they are not copied.
+                    auto pd =
+                        OSData::withBytesNoCopy(const_cast<uint8_t *>(entry.deviceData), sizeof(entry.deviceData));
                     if (pd) {
                         panels->setObject(entry.deviceName, pd);
-                        // No release required by current AppleBacklight implementation.
+                        pd->release();
                     } else {
                         SYSLOG("nred", "setDisplay: Cannot allocate data for %s", entry.deviceName);
                     }
                 }
                 that->setProperty("ApplePanels", panels);
+                panels->release();
+            } else {
+                SYSLOG("nred", "setDisplay: Cannot copy ApplePanels property");
             }
-
-            OSSafeReleaseNULL(rawPanels);
         } else {
             SYSLOG("nred", "setDisplay: Missing ApplePanels property");
         }
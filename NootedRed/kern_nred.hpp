@@ -9,6 +9,7 @@
 #include <IOKit/acpi/IOACPIPlatformExpert.h>
 #include <IOKit/graphics/IOFramebuffer.h>
 #include <IOKit/pci/IOPCIDevice.h>
+#include <kern/thread_call.h>
 
 class EXPORT PRODUCT_NAME : public IOService {
     OSDeclareDefaultStructors(PRODUCT_NAME);
@@ -16,6 +17,8 @@ class EXPORT PRODUCT_NAME : public IOService {
     public:
     IOService *probe(IOService *provider, SInt32 *score) override;
     bool start(IOService *provider) override;
+    bool serializeProperties(OSSerialize *serialize) const override;
+    IOReturn setProperties(OSObject *properties) override;
 };
 
 enum struct ChipType : uint32_t {
@@ -27,6 +30,62 @@ enum struct ChipType : uint32_t {
     Unknown,
 };
 
+struct ChipProfile {
+    ChipType chipType;
+    const char *gpuInfoFirmware;
+    const char *vcnFirmware;
+    uint32_t vcnIPVersion;
+    uint32_t displayPipeCount;
+    uint32_t bpp64SwModeMask;       // Swizzle modes the display can scan out for 64 bpp surfaces
+    uint32_t nonBpp64SwModeMask;    // Likewise for every other bpp
+    uint32_t deviceType;    // What `AMDRadeonX5000_AMDVega10GraphicsAccelerator::getDeviceType` reports
+    const uint32_t *ddiCaps;
+    bool dcn2;                   // DCN 2.1 rather than DCN 1.0
+    bool vcn2;                   // VCN 2.2 rather than VCN 1.0
+    bool gfx93;                  // GC 9.3 (Renoir family) rather than GC 9.1/9.2 (Raven family)
+    bool depthPipeXorDisable;    // Raven and Picasso silicon
+};
+
+/** Indexed by `ChipType`. */
+static constexpr ChipProfile chipProfiles[] = {
+    {ChipType::Raven, "raven_gpu_info.bin", "ativvaxy_rv.dat", 0x0100, 4, Dcn1Bpp64SwModeMask, Dcn1NonBpp64SwModeMask,
+        0, ddiCapsRaven, false, false, false, true},
+    {ChipType::Picasso, "picasso_gpu_info.bin", "ativvaxy_rv.dat", 0x0100, 4, Dcn1Bpp64SwModeMask,
+        Dcn1NonBpp64SwModeMask, 0, ddiCapsRaven, false, false, false, true},
+    {ChipType::Raven2, "raven2_gpu_info.bin", "ativvaxy_rv.dat", 0x0100, 4, Dcn1Bpp64SwModeMask,
+        Dcn1NonBpp64SwModeMask, 0, ddiCapsRaven, false, false, false, false},
+    {ChipType::Renoir, "renoir_gpu_info.bin", "ativvaxy_nv.dat", 0x0202, 6, Dcn2Bpp64SwModeMask,
+        Dcn2NonBpp64SwModeMask, 9, ddiCapsRenoir, true, true, true, false},
+    {ChipType::GreenSardine, "renoir_gpu_info.bin", "ativvaxy_nv.dat", 0x0202, 6, Dcn2Bpp64SwModeMask,
+        Dcn2NonBpp64SwModeMask, 9, ddiCapsRenoir, true, true, true, false},
+    // Selected until the chip is identified, and kept for unknown chips. Hooks such as `DYLDPatches::csValidatePage`
+    // read it from early boot, so its flags must match the old `chipType >= ChipType::Renoir` checks, which
+    // `Unknown` passed by sorting last.
+    {ChipType::Unknown, nullptr, nullptr, 0, 0, Dcn2Bpp64SwModeMask, Dcn2NonBpp64SwModeMask, 0, nullptr, true, true,
+        true, false},
+};
+
+static constexpr bool chipProfilesAreIndexed() {
+    for (size_t i = 0; i < arrsize(chipProfiles); i++) {
+        if (static_cast<size_t>(chipProfiles[i].chipType) != i) { return false; }
+    }
+    return arrsize(chipProfiles) == static_cast<size_t>(ChipType::Unknown) + 1;
+}
+
+static_assert(chipProfilesAreIndexed(), "chipProfiles must be indexed by ChipType");
+
+static constexpr bool chipProfileSwModeMasksMatchDCN() {
+    for (const auto &profile : chipProfiles) {
+        if (profile.bpp64SwModeMask != (profile.dcn2 ? Dcn2Bpp64SwModeMask : Dcn1Bpp64SwModeMask) ||
+            profile.nonBpp64SwModeMask != (profile.dcn2 ? Dcn2NonBpp64SwModeMask : Dcn1NonBpp64SwModeMask)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(chipProfileSwModeMasksMatchDCN(), "chipProfiles swizzle masks must match their DCN version");
+
 // Hack
 class AppleACPIPlatformExpert : IOACPIPlatformExpert {
     friend class NRed;
@@ -87,7 +146,50 @@ struct vc_info {
     unsigned int v_reserved[3];
 };
 
+/**
+ * How long to busy-wait for an SMU response before falling back to sleeping in 1ms steps.
+ * Most messages complete well within this window.
+ */
+constexpr uint32_t SMU_POLL_SPIN_USEC = 50;
+
+/** Wall-clock budget for an SMU response, the same as Linux allows smu12. */
+constexpr uint32_t SMU_RESP_TIMEOUT_MSEC = 2000;
+
+/** Maximum number of SMU messages waiting to be issued asynchronously. */
+constexpr size_t SMU_QUEUE_SIZE = 16;
+
+/** Open-addressed; kept at most half full so every probe sequence hits an empty slot. */
+constexpr size_t META_CLASS_REMAP_BITS = 4;
+constexpr size_t META_CLASS_REMAP_SLOTS = 1 << META_CLASS_REMAP_BITS;
+
+struct MetaClassRemap {
+    const OSMetaClass *from, *to;
+};
+
+/** Direct-mapped cache of whether a metaclass descends from a remapped AMD accelerator class. */
+constexpr size_t META_CLASS_ANCESTRY_BITS = 6;
+constexpr size_t META_CLASS_ANCESTRY_SLOTS = 1 << META_CLASS_ANCESTRY_BITS;
+
+/** Latency histograms use log2(microseconds) buckets; the last one also covers timeouts. */
+constexpr size_t SMU_LATENCY_BUCKETS = 18;
+
+/** Message IDs at or beyond this are not tracked individually. */
+constexpr uint32_t SMU_STATS_MSG_COUNT = 0x40;
+
+struct SMUMsgStats {
+    uint64_t count;
+    uint32_t timeouts;
+    uint32_t lastResp;
+    uint32_t preCheckLatency[SMU_LATENCY_BUCKETS];
+    uint32_t respLatency[SMU_LATENCY_BUCKETS];
+};
+
+struct SMUMessage {
+    uint32_t msg, param;
+};
+
 class NRed {
+    friend class PRODUCT_NAME;
     friend class DYLDPatches;
     friend class X6000FB;
     friend class X5000HWLibs;
@@ -99,16 +201,10 @@ class NRed {
 
     void init();
     void processPatcher(KernelPatcher &patcher);
-    void setRMMIOIfNecessary();
+    bool setRMMIOIfNecessary();
     void processKext(KernelPatcher &patcher, size_t index, mach_vm_address_t address, size_t size);
 
     private:
-    static const char *getChipName() {
-        PANIC_COND(callback->chipType == ChipType::Unknown, "nred", "Unknown chip type");
-        static const char *chipNames[] = {"raven", "raven2", "picasso", "renoir", "green_sardine"};
-        return chipNames[static_cast<int>(callback->chipType)];
-    }
-
     bool getVBIOSFromVFCT(IOPCIDevice *obj) {
         DBGLOG("nred", "Fetching VBIOS from VFCT table");
         auto *expert = reinterpret_cast<AppleACPIPlatformExpert *>(obj->getPlatform());
@@ -182,47 +278,87 @@ class NRed {
     }
 
     uint32_t readReg32(uint32_t reg) {
-        if (reg * 4 < this->rmmio->getLength()) {
-            return this->rmmioPtr[reg];
-        } else {
-            this->rmmioPtr[mmPCIE_INDEX2] = reg;
-            return this->rmmioPtr[mmPCIE_DATA2];
-        }
+        if (reg * 4 < this->rmmio->getLength()) { return this->rmmioPtr[reg]; }
+
+        IOSimpleLockLock(this->regLock);
+        auto ret = this->readIndirectReg32(reg);
+        IOSimpleLockUnlock(this->regLock);
+        return ret;
     }
 
     void writeReg32(uint32_t reg, uint32_t val) {
-        if ((reg * 4) < this->rmmio->getLength()) {
+        if (reg * 4 < this->rmmio->getLength()) {
             this->rmmioPtr[reg] = val;
-        } else {
-            this->rmmioPtr[mmPCIE_INDEX2] = reg;
-            this->rmmioPtr[mmPCIE_DATA2] = val;
+            return;
         }
-    }
 
-    uint32_t sendMsgToSmc(uint32_t msg, uint32_t param = 0) {
-        auto smuWaitForResp = [=]() {
-            uint32_t ret = 0;
-            for (uint32_t i = 0; i < AMDGPU_MAX_USEC_TIMEOUT; i++) {
-                ret = this->readReg32(MP_BASE + mmMP1_SMN_C2PMSG_90);
-                if (ret) return ret;
+        IOSimpleLockLock(this->regLock);
+        this->writeIndirectReg32(reg, val);
+        IOSimpleLockUnlock(this->regLock);
+    }
 
-                IOSleep(1);
-            }
+    /**
+     * Read-modify-write of the bits in `mask`, serialised against other RMWs and the index/data pair.
+     * Returns the value written.
+     */
+    uint32_t updateReg32(uint32_t reg, uint32_t mask, uint32_t value) {
+        IOSimpleLockLock(this->regLock);
+        auto ret = this->updateRegLocked32(reg, mask, value);
+        IOSimpleLockUnlock(this->regLock);
+        return ret;
+    }
 
-            return ret;
-        };
+    uint32_t readIndirectReg32(uint32_t reg) {
+        this->rmmioPtr[mmPCIE_INDEX2] = reg;
+        return this->rmmioPtr[mmPCIE_DATA2];
+    }
 
-        PANIC_COND(smuWaitForResp() != 1, "nred", "Msg issuing pre-check failed; SMU may be in an improper state");
+    void writeIndirectReg32(uint32_t reg, uint32_t val) {
+        this->rmmioPtr[mmPCIE_INDEX2] = reg;
+        this->rmmioPtr[mmPCIE_DATA2] = val;
+    }
 
-        this->writeReg32(MP_BASE + mmMP1_SMN_C2PMSG_90, 0);
-        this->writeReg32(MP_BASE + mmMP1_SMN_C2PMSG_82, param);
-        this->writeReg32(MP_BASE + mmMP1_SMN_C2PMSG_66, msg);
+    uint32_t updateRegLocked32(uint32_t reg, uint32_t mask, uint32_t value) {
+        auto direct = reg * 4 < this->rmmio->getLength();
+        auto val = direct ? this->rmmioPtr[reg] : this->readIndirectReg32(reg);
+        val = (val & ~mask) | (value & mask);
+        if (direct) {
+            this->rmmioPtr[reg] = val;
+        } else {
+            this->writeIndirectReg32(reg, val);
+        }
+        return val;
+    }
 
-        PANIC_COND(smuWaitForResp() != 1, "nred", "No response from SMU");
+    CAILResult waitForSMUResp(uint32_t &resp, size_t &bucket);
+    void recordSMUWait(SMUMsgStats &stats, uint32_t *latency, size_t bucket, uint32_t resp);
+    CAILResult sendMsgToSmcLocked(uint32_t msg, uint32_t param, uint32_t *outParam);
+    size_t drainSMUQueueLocked(size_t limit = SMU_QUEUE_SIZE);
+    CAILResult sendMsgToSmc(uint32_t msg, uint32_t param = 0, uint32_t *outParam = nullptr);
+    void queueMsgToSmc(uint32_t msg, uint32_t param = 0);
+    static void processSMUQueue(thread_call_param_t param0, thread_call_param_t param1);
+    OSDictionary *copySMUStats();
+
+    static size_t hashMetaClass(const OSMetaClass *meta, size_t bits) {
+        return static_cast<size_t>((reinterpret_cast<uintptr_t>(meta) >> 3) * 0x9E3779B97F4A7C15ULL >> (64 - bits));
+    }
 
-        return this->readReg32(MP_BASE + mmMP1_SMN_C2PMSG_82);
+    const OSMetaClass *getMetaClassRemap(const OSMetaClass *meta) {
+        auto addr = reinterpret_cast<uintptr_t>(meta);
+        if (LIKELY(addr > __atomic_load_n(&this->metaClassRangeEnd, __ATOMIC_ACQUIRE) ||
+                   addr < this->metaClassRangeStart)) {
+            return nullptr;
+        }
+        for (auto i = hashMetaClass(meta, META_CLASS_REMAP_BITS);; i = (i + 1) % META_CLASS_REMAP_SLOTS) {
+            auto &entry = this->metaClassRemap[i];
+            if (entry.from == meta) { return entry.to; }
+            if (!entry.from) { return nullptr; }
+        }
     }
 
+    void buildMetaClassRemap();
+    bool hasRemappedAncestor(const OSMetaClass *meta);
+
     template<typename T>
     T *getVBIOSDataTable(uint32_t index) {
         auto *vbios = static_cast<const uint8_t *>(this->vbiosData->getBytesNoCopy());
@@ -233,17 +369,33 @@ class NRed {
         return offset ? reinterpret_cast<T *>(const_cast<uint8_t *>(vbios) + offset) : nullptr;
     }
 
+    void processVBIOSConnectors();
+    void processVBIOSVramInfo();
+
     OSData *vbiosData {nullptr};
     ChipType chipType {ChipType::Unknown};
+    const ChipProfile *chipProfile {&chipProfiles[static_cast<size_t>(ChipType::Unknown)]};
     uint64_t fbOffset {0};
     IOMemoryMap *rmmio {nullptr};
     volatile uint32_t *rmmioPtr {nullptr};
+    IOSimpleLock *regLock {nullptr};
+    IOLock *smuLock {nullptr};
+    IOSimpleLock *smuStatsLock {nullptr};
+    thread_call_t smuQueueCall {nullptr};
+    SMUMessage smuQueue[SMU_QUEUE_SIZE] {};
+    size_t smuQueueHead {0}, smuQueueCount {0};
+    SMUMsgStats smuStats[SMU_STATS_MSG_COUNT] {};
     uint32_t deviceId {0};
     uint16_t enumRevision {0};
     uint16_t revision {0};
     uint32_t pciRevision {0};
+    uint32_t videoMemoryType {kVideoMemoryTypeUnknown};
+    uint32_t vramWidth {64};
     IOPCIDevice *iGPU {nullptr};
     OSMetaClass *metaClassMap[4][2] = {{nullptr}};
+    MetaClassRemap metaClassRemap[META_CLASS_REMAP_SLOTS] {};
+    uintptr_t metaClassRangeStart {0}, metaClassRangeEnd {0};
+    uintptr_t metaClassAncestry[META_CLASS_ANCESTRY_SLOTS] {};
     mach_vm_address_t orgSafeMetaCast {0};
     mach_vm_address_t orgApplePanelSetDisplay {0};
 
@@ -134,15 +134,6 @@ static const uint8_t kDceDriverSetBacklight[] = {0x55, 0x48, 0x89, 0xE5, 0x41, 0
 static const uint8_t kPopulateVramInfoPattern[] = {0x55, 0x48, 0x89, 0xE5, 0x41, 0x57, 0x41, 0x56, 0x53, 0x48, 0x81,
     0xEC, 0x08, 0x01, 0x00, 0x00, 0x49, 0x89, 0xF6, 0x48, 0x89, 0xFB, 0x4C, 0x8D, 0xBD, 0xE0, 0xFE, 0xFF, 0xFF};
 
-/**
- * `__ZNK22AmdAtomObjectInfo_V1_421getNumberOfConnectorsEv`
- * AMDRadeonX6000Framebuffer.kext
- */
-static const uint8_t kGetNumberOfConnectorsPattern[] = {0x55, 0x48, 0x89, 0xE5, 0x4C, 0x8B, 0x47, 0x28, 0x41, 0x0F,
-    0xB6, 0x40, 0x06, 0x85, 0xC0, 0x74, 0x00};
-static const uint8_t kGetNumberOfConnectorsMask[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00};
-
 /**
  * `_IH_4_0_IVRing_InitHardware`
  * AMDRadeonX6000Framebuffer.kext
@@ -2,11 +2,13 @@
 //  details.
 
 #include "kern_nred.hpp"
+#include "kern_x5000.hpp"
 #include "kern_x6000fb.hpp"
 #include <Headers/kern_api.hpp>
 #include <Headers/kern_version.hpp>
 #include <Headers/plugin_start.hpp>
 #include <IOKit/IOCatalogue.h>
+#include <IOKit/IOUserClient.h>
 
 static NRed nred;
 
@@ -73,3 +75,42 @@ bool PRODUCT_NAME::start(IOService *provider) {
 
     return true;
 }
+
+bool PRODUCT_NAME::serializeProperties(OSSerialize *serialize) const {
+    if (NRed::callback) {
+        auto *smuStats = NRed::callback->copySMUStats();
+        if (smuStats) {
+            const_cast<PRODUCT_NAME *>(this)->setProperty("SMUStats", smuStats);
+            smuStats->release();
+        }
+    }
+#if NRED_SDMA_STATS
+    if (X5000::callback) {
+        auto *channelStats = X5000::callback->copyHWChannelStats();
+        if (channelStats) {
+            const_cast<PRODUCT_NAME *>(this)->setProperty("HWChannelStats", channelStats);
+            channelStats->release();
+        }
+        auto *sdmaStats = X5000::callback->copySDMAStats();
+        if (sdmaStats) {
+            const_cast<PRODUCT_NAME *>(this)->setProperty("SDMAStats", sdmaStats);
+            sdmaStats->release();
+        }
+    }
+#endif
+    return IOService::serializeProperties(serialize);
+}
+
+IOReturn PRODUCT_NAME::setProperties(OSObject *properties) {
+#if NRED_SDMA_STATS
+    auto *dict = OSDynamicCast(OSDictionary, properties);
+    if (dict && X5000::callback && dict->getObject("ResetSDMAStats")) {
+        if (IOUserClient::clientHasPrivilege(current_task(), kIOClientPrivilegeAdministrator) != kIOReturnSuccess) {
+            return kIOReturnNotPrivileged;
+        }
+        X5000::callback->resetSDMAStats();
+        return kIOReturnSuccess;
+    }
+#endif
+    return IOService::setProperties(properties);
+}
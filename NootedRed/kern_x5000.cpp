@@ -18,12 +18,16 @@ X5000 *X5000::callback = nullptr;
 
 void X5000::init() {
     callback = this;
+    this->hwAlignMgrLock = IOSimpleLockAlloc();
+    PANIC_COND(!this->hwAlignMgrLock, "x5000", "Failed to allocate align manager lock");
     lilu.onKextLoadForce(&kextRadeonX5000);
 }
 
 bool X5000::processKext(KernelPatcher &patcher, size_t index, mach_vm_address_t address, size_t size) {
     if (kextRadeonX5000.loadIndex == index) {
-        NRed::callback->setRMMIOIfNecessary();
+        if (!NRed::callback->setRMMIOIfNecessary()) { return true; }
+        this->decodeGPUTopology();
+        this->buildHWEngineMap();
 
         uint32_t *orgChannelTypes = nullptr;
         mach_vm_address_t startHWEngines = 0;
@@ -45,6 +49,7 @@ bool X5000::processKext(KernelPatcher &patcher, size_t index, mach_vm_address_t
         };
         PANIC_COND(!SolveRequestPlus::solveAll(&patcher, index, solveRequests, address, size), "x5000",
             "Failed to resolve symbols");
+        NRed::callback->buildMetaClassRemap();
 
         auto ventura = getKernelVersion() >= KernelVersion::Ventura;
         auto ventura1304 = (ventura && getKernelMinorVersion() >= 5) || getKernelVersion() > KernelVersion::Ventura;
@@ -85,14 +90,17 @@ bool X5000::processKext(KernelPatcher &patcher, size_t index, mach_vm_address_t
             kStartHWEnginesPatched, kStartHWEnginesMask, ventura ? 2U : 1};
         PANIC_COND(!patch.apply(&patcher, startHWEngines, PAGE_SIZE), "x5000", "Failed to patch startHWEngines");
 
-        uint32_t findBpp64 = Dcn1Bpp64SwModeMask, replBpp64 = Dcn2Bpp64SwModeMask;
-        uint32_t findNonBpp64 = Dcn1NonBpp64SwModeMask, replNonBpp64 = Dcn2NonBpp64SwModeMask;
-        auto dcn2 = NRed::callback->chipType >= ChipType::Renoir;
+        // X5000 ships the DCN 1 masks.
+        auto *profile = NRed::callback->chipProfile;
+        uint32_t findBpp64 = Dcn1Bpp64SwModeMask, replBpp64 = profile->bpp64SwModeMask;
+        uint32_t findNonBpp64 = Dcn1NonBpp64SwModeMask, replNonBpp64 = profile->nonBpp64SwModeMask;
         const LookupPatchPlus swizzleModePatches[] = {
             {&kextRadeonX5000, reinterpret_cast<const uint8_t *>(&findBpp64),
-                reinterpret_cast<const uint8_t *>(&replBpp64), sizeof(uint32_t), ventura1304 ? 2U : 4, dcn2},
+                reinterpret_cast<const uint8_t *>(&replBpp64), sizeof(uint32_t), ventura1304 ? 2U : 4,
+                replBpp64 != findBpp64},
             {&kextRadeonX5000, reinterpret_cast<const uint8_t *>(&findNonBpp64),
-                reinterpret_cast<const uint8_t *>(&replNonBpp64), sizeof(uint32_t), ventura1304 ? 2U : 4, dcn2},
+                reinterpret_cast<const uint8_t *>(&replNonBpp64), sizeof(uint32_t), ventura1304 ? 2U : 4,
+                replNonBpp64 != findNonBpp64},
         };
         PANIC_COND(!LookupPatchPlus::applyAll(&patcher, swizzleModePatches, address, size), "x5000",
             "Failed to patch swizzle mode");
@@ -137,34 +145,132 @@ enum HWCapability : uint64_t {
     HasVCN0 = 0x87,             // bool
 };
 
+struct HWCapabilityLayout {
+    KernelVersion since;
+    uint64_t base;    // Offset of the capabilities in `AMDRadeonX5000_AMDHardware`
+};
+
+/** Newest first. */
+static constexpr HWCapabilityLayout hwCapabilityLayouts[] = {
+    {KernelVersion::Ventura, 0x30},
+    {KernelVersion::BigSur, 0x28},
+};
+
+static constexpr uint64_t getHWCapabilityBase(KernelVersion version) {
+    for (const auto &layout : hwCapabilityLayouts) {
+        if (version >= layout.since) { return layout.base; }
+    }
+    return hwCapabilityLayouts[arrsize(hwCapabilityLayouts) - 1].base;
+}
+
+static_assert(getHWCapabilityBase(KernelVersion::BigSur) == 0x28);
+static_assert(getHWCapabilityBase(KernelVersion::Monterey) == 0x28);
+static_assert(getHWCapabilityBase(KernelVersion::Ventura) == 0x30);
+static_assert(getHWCapabilityBase(KernelVersion::Ventura) + HWCapability::SECount == 0x64);
+static_assert(getHWCapabilityBase(KernelVersion::Monterey) + HWCapability::CUPerSH == 0x98);
+
 template<typename T>
 static inline void setHWCapability(void *that, HWCapability capability, T value) {
-    getMember<T>(that, (getKernelVersion() >= KernelVersion::Ventura ? 0x30 : 0x28) + capability) = value;
+    getMember<T>(that, getHWCapabilityBase(getKernelVersion()) + capability) = value;
 }
 
-void X5000::wrapSetupAndInitializeHWCapabilities(void *that) {
-    auto isRavenDerivative = NRed::callback->chipType < ChipType::Renoir;
-    char filename[128] = {0};
-    snprintf(filename, arrsize(filename), "%s_gpu_info.bin", isRavenDerivative ? NRed::getChipName() : "renoir");
+struct TopologyCapability {
+    HWCapability capability;
+    uint32_t GPUTopology::*field;
+};
+
+/**
+ * Topology fields with a known capability slot.
+ * The RB, TCC, wave and LDS fields are decoded too, but have no slot we know of yet.
+ */
+static constexpr TopologyCapability topologyCapabilities[] = {
+    {HWCapability::SECount, &GPUTopology::seCount},
+    {HWCapability::SHPerSE, &GPUTopology::shPerSE},
+    {HWCapability::CUPerSH, &GPUTopology::cuPerSH},
+};
+
+void X5000::decodeGPUTopology() {
+    auto *filename = NRed::callback->chipProfile->gpuInfoFirmware;
     auto &fwDesc = getFWDescByName(filename);
     auto *header = reinterpret_cast<const CommonFirmwareHeader *>(fwDesc.data);
+    PANIC_COND(header->ucodeOff + sizeof(GPUInfoFirmware) > fwDesc.size, "x5000", "%s is truncated", filename);
     auto *gpuInfo = reinterpret_cast<const GPUInfoFirmware *>(fwDesc.data + header->ucodeOff);
 
-    setHWCapability<uint32_t>(that, HWCapability::SECount, gpuInfo->gcNumSe);
-    setHWCapability<uint32_t>(that, HWCapability::SHPerSE, gpuInfo->gcNumShPerSe);
-    setHWCapability<uint32_t>(that, HWCapability::CUPerSH, gpuInfo->gcNumCuPerSh);
+    this->gpuTopology = {
+        .seCount = gpuInfo->gcNumSe,
+        .shPerSE = gpuInfo->gcNumShPerSe,
+        .cuPerSH = gpuInfo->gcNumCuPerSh,
+        .rbPerSE = gpuInfo->gcNumRbPerSe,
+        .tccCount = gpuInfo->gcNumTccs,
+        .waveSize = gpuInfo->gcWaveSize,
+        .maxWavesPerSimd = gpuInfo->gcMaxWavesPerSimd,
+        .ldsSize = gpuInfo->gcLdsSize,
+    };
+    DBGLOG("x5000", "GPU topology from %s: %u SE, %u SH/SE, %u CU/SH, %u RB/SE", filename, this->gpuTopology.seCount,
+        this->gpuTopology.shPerSE, this->gpuTopology.cuPerSH, this->gpuTopology.rbPerSE);
+}
+
+void X5000::wrapSetupAndInitializeHWCapabilities(void *that) {
+    for (const auto &ent : topologyCapabilities) {
+        setHWCapability<uint32_t>(that, ent.capability, callback->gpuTopology.*ent.field);
+    }
 
     FunctionCast(wrapSetupAndInitializeHWCapabilities, callback->orgSetupAndInitializeHWCapabilities)(that);
 
-    setHWCapability<uint32_t>(that, HWCapability::DisplayPipeCount, isRavenDerivative ? 4 : 6);
+    setHWCapability<uint32_t>(that, HWCapability::DisplayPipeCount, NRed::callback->chipProfile->displayPipeCount);
     setHWCapability<bool>(that, HWCapability::HasUVD0, false);
     setHWCapability<bool>(that, HWCapability::HasVCE, false);
     setHWCapability<bool>(that, HWCapability::HasVCN0, true);
 }
 
+/**
+ * Logical to physical engine routing for `getHWChannel`.
+ * Every chip we support has a single SDMA engine, so SDMA1 work lands on SDMA0.
+ */
+void X5000::buildHWEngineMap() {
+    for (uint32_t i = 0; i < AMD_HW_ENGINE_COUNT; i++) { this->hwEngineMap[i] = i; }
+    this->hwEngineMap[AMD_HW_ENGINE_SDMA1] = AMD_HW_ENGINE_SDMA0;
+}
+
+#if NRED_SDMA_STATS
+/**
+ * Per logical engine `getHWChannel` lookups and where they were routed, keyed by engine type.
+ */
+OSDictionary *X5000::copyHWChannelStats() {
+    auto *dict = OSDictionary::withCapacity(AMD_HW_ENGINE_COUNT);
+    if (!dict) { return nullptr; }
+    char key[8];
+    for (size_t i = 0; i < AMD_HW_ENGINE_COUNT; i++) {
+        auto lookups = this->getChannelLookups(i);
+        if (!lookups) { continue; }
+        auto *ent = OSDictionary::withCapacity(2);
+        if (!ent) { continue; }
+        auto *num = OSNumber::withNumber(lookups, 64);
+        if (num) {
+            ent->setObject("Lookups", num);
+            num->release();
+        }
+        num = OSNumber::withNumber(this->hwEngineMap[i], 32);
+        if (num) {
+            ent->setObject("RoutedTo", num);
+            num->release();
+        }
+        snprintf(key, arrsize(key), "%zu", i);
+        dict->setObject(key, ent);
+        ent->release();
+    }
+    return dict;
+}
+#endif
+
 void *X5000::wrapGetHWChannel(void *that, uint32_t engineType, uint32_t ringId) {
-    /** Redirect SDMA1 engine type to SDMA0 */
-    return FunctionCast(wrapGetHWChannel, callback->orgGetHWChannel)(that, (engineType == 2) ? 1 : engineType, ringId);
+    if (LIKELY(engineType < AMD_HW_ENGINE_COUNT)) {
+#if NRED_SDMA_STATS
+        __atomic_fetch_add(&callback->getSDMAStats().channelLookups[engineType], 1, __ATOMIC_RELAXED);
+#endif
+        engineType = callback->hwEngineMap[engineType];
+    }
+    return FunctionCast(wrapGetHWChannel, callback->orgGetHWChannel)(that, engineType, ringId);
 }
 
 void X5000::wrapInitializeFamilyType(void *that) { getMember<uint32_t>(that, 0x308) = AMDGPU_FAMILY_RAVEN; }
@@ -192,21 +298,45 @@ void *X5000::wrapNewSharedUserClient() {
     return FunctionCast(wrapNewSharedUserClient, X6000::callback->orgNewSharedUserClient)();
 }
 
+/**
+ * Build the hybrid X5000/X6000 align manager vtable.
+ * All align managers share the same X5000 vtable, so this is done once and the result reused on restarts.
+ */
+void X5000::buildHWAlignMgrVtX6000(const mach_vm_address_t *vtX5000) {
+    constexpr size_t entries = HWALIGNMGR_VT_X5000_SIZE / sizeof(mach_vm_address_t);
+    constexpr size_t split = HWALIGNMGR_VT_SWIZZLE_MODE2_OFF / sizeof(mach_vm_address_t);
+    for (size_t i = 0; i < entries; i++) {
+        PANIC_COND(!vtX5000[i], "x5000", "Align manager vtable entry %zu is null; vtable is shorter than expected", i);
+    }
+
+    memcpy(this->hwAlignMgrVtX6000, vtX5000, HWALIGNMGR_VT_SWIZZLE_MODE2_OFF);
+    this->hwAlignMgrVtX6000[split] = X6000::callback->orgGetPreferredSwizzleMode2;
+    memcpy(this->hwAlignMgrVtX6000 + split + 1, vtX5000 + split,
+        HWALIGNMGR_VT_X5000_SIZE - HWALIGNMGR_VT_SWIZZLE_MODE2_OFF);
+    this->hwAlignMgrVtX5000 = vtX5000;
+}
+
 void *X5000::wrapAllocateAMDHWAlignManager() {
     auto ret = FunctionCast(wrapAllocateAMDHWAlignManager, callback->orgAllocateAMDHWAlignManager)();
-    callback->hwAlignMgr = ret;
-
-    callback->hwAlignMgrVtX5000 = getMember<uint8_t *>(ret, 0);
-    callback->hwAlignMgrVtX6000 = IONewZero(uint8_t, 0x238);
 
-    memcpy(callback->hwAlignMgrVtX6000, callback->hwAlignMgrVtX5000, 0x128);
-    *reinterpret_cast<mach_vm_address_t *>(callback->hwAlignMgrVtX6000 + 0x128) =
-        X6000::callback->orgGetPreferredSwizzleMode2;
-    memcpy(callback->hwAlignMgrVtX6000 + 0x130, callback->hwAlignMgrVtX5000 + 0x128, 0x230 - 0x128);
+    auto *vtX5000 = getMember<const mach_vm_address_t *>(ret, 0);
+    IOSimpleLockLock(callback->hwAlignMgrLock);
+    // The hybrid vtable must not be rewritten while an `HWAlignMgrX6000Scope` may have it installed.
+    if (UNLIKELY(vtX5000 != callback->hwAlignMgrVtX5000)) {
+        for (auto &ent : callback->hwAlignMgrX6000Users) {
+            PANIC_COND(ent.users, "x5000", "Align manager vtable changed while in use");
+        }
+    }
+    callback->hwAlignMgr = ret;
+    if (UNLIKELY(vtX5000 != callback->hwAlignMgrVtX5000)) {
+        SYSLOG_COND(callback->hwAlignMgrVtX5000, "x5000", "Align manager vtable changed, rebuilding");
+        callback->buildHWAlignMgrVtX6000(vtX5000);
+    }
+    IOSimpleLockUnlock(callback->hwAlignMgrLock);
     return ret;
 }
 
-uint32_t X5000::wrapGetDeviceType() { return NRed::callback->chipType < ChipType::Renoir ? 0 : 9; }
+uint32_t X5000::wrapGetDeviceType() { return NRed::callback->chipProfile->deviceType; }
 
 uint32_t X5000::wrapReturnZero() { return 0; }
 
@@ -215,27 +345,98 @@ static void fixAccelGroup(void *that) {
     sdma1 = sdma1 ?: getMember<void *>(that, 0x10);    // Replace field with SDMA0, as we have no SDMA1
 }
 
+#if NRED_SDMA_STATS
+void X5000::recordAccelGroupObtain(uint64_t start, bool success) {
+    uint64_t obtainNs;
+    absolutetime_to_nanoseconds(mach_absolute_time() - start, &obtainNs);
+    auto &stats = this->getSDMAStats();
+    __atomic_fetch_add(success ? &stats.groupObtains : &stats.groupFailures, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats.groupObtainNs, obtainNs, __ATOMIC_RELAXED);
+    auto max = __atomic_load_n(&stats.groupMaxObtainNs, __ATOMIC_RELAXED);
+    while (obtainNs > max && !__atomic_compare_exchange_n(&stats.groupMaxObtainNs, &max, obtainNs, true,
+                                 __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+}
+
+uint64_t X5000::getChannelLookups(size_t engineType) {
+    uint64_t total = 0;
+    for (auto &stats : this->sdmaStats) {
+        total += __atomic_load_n(&stats.channelLookups[engineType], __ATOMIC_RELAXED);
+    }
+    return total;
+}
+
+/**
+ * Totals over all CPU slots.
+ * The group counters time `obtainAccelChannelGroup`, which allocates a channel group; it does not wait on any ring.
+ */
+OSDictionary *X5000::copySDMAStats() {
+    uint64_t totals[5] = {this->getChannelLookups(AMD_HW_ENGINE_SDMA0) + this->getChannelLookups(AMD_HW_ENGINE_SDMA1)};
+    for (auto &stats : this->sdmaStats) {
+        totals[1] += __atomic_load_n(&stats.groupObtains, __ATOMIC_RELAXED);
+        totals[2] += __atomic_load_n(&stats.groupFailures, __ATOMIC_RELAXED);
+        totals[3] += __atomic_load_n(&stats.groupObtainNs, __ATOMIC_RELAXED);
+        auto max = __atomic_load_n(&stats.groupMaxObtainNs, __ATOMIC_RELAXED);
+        if (max > totals[4]) { totals[4] = max; }
+    }
+
+    static const char *keys[] = {"ChannelLookups", "GroupObtains", "GroupFailures", "GroupObtainNs",
+        "GroupMaxObtainNs"};
+    auto *dict = OSDictionary::withCapacity(arrsize(keys));
+    if (!dict) { return nullptr; }
+    for (size_t i = 0; i < arrsize(keys); i++) {
+        auto *num = OSNumber::withNumber(totals[i], 64);
+        if (num) {
+            dict->setObject(keys[i], num);
+            num->release();
+        }
+    }
+    return dict;
+}
+
+void X5000::resetSDMAStats() {
+    for (auto &stats : this->sdmaStats) {
+        for (auto &lookups : stats.channelLookups) { __atomic_store_n(&lookups, 0, __ATOMIC_RELAXED); }
+        __atomic_store_n(&stats.groupObtains, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stats.groupFailures, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stats.groupObtainNs, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stats.groupMaxObtainNs, 0, __ATOMIC_RELAXED);
+    }
+}
+#endif
+
 void *X5000::wrapObtainAccelChannelGroup(void *that, uint32_t priority) {
+#if NRED_SDMA_STATS
+    auto start = mach_absolute_time();
+#endif
     auto ret = FunctionCast(wrapObtainAccelChannelGroup, callback->orgObtainAccelChannelGroup)(that, priority);
+#if NRED_SDMA_STATS
+    callback->recordAccelGroupObtain(start, ret);
+#endif
     if (ret) { fixAccelGroup(ret); }
     return ret;
 }
 
 void *X5000::wrapObtainAccelChannelGroup1304(void *that, uint32_t priority, void *task) {
+#if NRED_SDMA_STATS
+    auto start = mach_absolute_time();
+#endif
     auto ret =
         FunctionCast(wrapObtainAccelChannelGroup1304, callback->orgObtainAccelChannelGroup)(that, priority, task);
+#if NRED_SDMA_STATS
+    callback->recordAccelGroupObtain(start, ret);
+#endif
     if (ret) { fixAccelGroup(ret); }
     return ret;
 }
 
 uint32_t X5000::wrapHwlConvertChipFamily(void *that, uint32_t, uint32_t) {
     auto &settings = getMember<Gfx9ChipSettings>(that, 0x5B10);
-    auto renoir = NRed::callback->chipType >= ChipType::Renoir;
+    auto *profile = NRed::callback->chipProfile;
     settings.isArcticIsland = 1;
     settings.isRaven = 1;
-    settings.depthPipeXorDisable = NRed::callback->chipType < ChipType::Raven2;
-    settings.htileAlignFix = renoir;
-    settings.applyAliasFix = renoir;
+    settings.depthPipeXorDisable = profile->depthPipeXorDisable;
+    settings.htileAlignFix = profile->gfx93;
+    settings.applyAliasFix = profile->gfx93;
     settings.isDcn1 = 1;
     settings.metaBaseAlignFix = 1;
     return ADDR_CHIP_FAMILY_AI;
@@ -5,8 +5,47 @@
 #include "kern_amd.hpp"
 #include <Headers/kern_patcher.hpp>
 
+/** Size of the X5000 `AMDHWAlignManager2` vtable we copy from. */
+constexpr size_t HWALIGNMGR_VT_X5000_SIZE = 0x230;
+/** Where X6000 has `getPreferredSwizzleMode2`; every X5000 entry from here on moves up one slot. */
+constexpr size_t HWALIGNMGR_VT_SWIZZLE_MODE2_OFF = 0x128;
+constexpr size_t HWALIGNMGR_VT_X6000_SIZE = HWALIGNMGR_VT_X5000_SIZE + sizeof(mach_vm_address_t);
+/** How many align managers can have the hybrid vtable installed at once, e.g. across an accelerator restart. */
+constexpr size_t HWALIGNMGR_X6000_SLOTS = 4;
+
+struct HWAlignMgrX6000Users {
+    void *mgr;
+    uint32_t users;
+};
+
+/** Channel lookup and group allocation counters. On in DEBUG builds, otherwise off unless `NRED_SDMA_STATS=1`. */
+#ifndef NRED_SDMA_STATS
+#ifdef DEBUG
+#define NRED_SDMA_STATS 1
+#else
+#define NRED_SDMA_STATS 0
+#endif
+#endif
+
+#if NRED_SDMA_STATS
+#include <kern/cpu_number.h>
+
+constexpr size_t SDMA_STATS_CPU_SLOTS = 64;
+
+/** One per CPU slot, cache line sized so that CPUs don't contend on each other's counters. */
+struct alignas(64) SDMACPUStats {
+    uint64_t channelLookups[AMD_HW_ENGINE_COUNT];
+    uint64_t groupObtains;
+    uint64_t groupFailures;
+    uint64_t groupObtainNs;
+    uint64_t groupMaxObtainNs;
+};
+#endif
+
 class X5000 {
+    friend class PRODUCT_NAME;
     friend class X6000;
+    friend class HWAlignMgrX6000Scope;
 
     public:
     static X5000 *callback;
@@ -24,8 +63,26 @@ class X5000 {
     mach_vm_address_t orgAllocateAMDHWAlignManager {0};
     mach_vm_address_t orgObtainAccelChannelGroup {0};
     void *hwAlignMgr {nullptr};
-    uint8_t *hwAlignMgrVtX5000 {nullptr};
-    uint8_t *hwAlignMgrVtX6000 {nullptr};
+    const mach_vm_address_t *hwAlignMgrVtX5000 {nullptr};
+    mach_vm_address_t hwAlignMgrVtX6000[HWALIGNMGR_VT_X6000_SIZE / sizeof(mach_vm_address_t)] {};
+    IOSimpleLock *hwAlignMgrLock {nullptr};
+    HWAlignMgrX6000Users hwAlignMgrX6000Users[HWALIGNMGR_X6000_SLOTS] {};
+    GPUTopology gpuTopology {};
+    uint32_t hwEngineMap[AMD_HW_ENGINE_COUNT] {};
+
+    void decodeGPUTopology();
+    void buildHWEngineMap();
+
+#if NRED_SDMA_STATS
+    SDMACPUStats sdmaStats[SDMA_STATS_CPU_SLOTS] {};
+
+    SDMACPUStats &getSDMAStats() { return this->sdmaStats[static_cast<size_t>(cpu_number()) % SDMA_STATS_CPU_SLOTS]; }
+    void recordAccelGroupObtain(uint64_t start, bool success);
+    uint64_t getChannelLookups(size_t engineType);
+    OSDictionary *copyHWChannelStats();
+    OSDictionary *copySDMAStats();
+    void resetSDMAStats();
+#endif
 
     static bool wrapAllocateHWEngines(void *that);
     static void wrapSetupAndInitializeHWCapabilities(void *that);
@@ -37,6 +94,7 @@ class X5000 {
     static void *wrapCreateSMLInterface(uint32_t configBit);
     static void *wrapNewShared();
     static void *wrapNewSharedUserClient();
+    void buildHWAlignMgrVtX6000(const mach_vm_address_t *vtX5000);
     static void *wrapAllocateAMDHWAlignManager();
     static uint32_t wrapGetDeviceType();
     static uint32_t wrapReturnZero();
@@ -22,7 +22,7 @@ void X6000::init() {
 
 bool X6000::processKext(KernelPatcher &patcher, size_t index, mach_vm_address_t address, size_t size) {
     if (kextRadeonX6000.loadIndex == index) {
-        NRed::callback->setRMMIOIfNecessary();
+        if (!NRed::callback->setRMMIOIfNecessary()) { return true; }
 
         KernelPatcher::SolveRequest solveRequests[] = {
             {"__ZN30AMDRadeonX6000_AMDVCN2HWEngineC1Ev", this->orgVCN2EngineConstructor},
@@ -39,6 +39,7 @@ bool X6000::processKext(KernelPatcher &patcher, size_t index, mach_vm_address_t
                 this->orgGetPreferredSwizzleMode2},
         };
         PANIC_COND(!patcher.solveMultiple(index, solveRequests, address, size), "x6000", "Failed to resolve symbols");
+        NRed::callback->buildMetaClassRemap();
 
         auto ventura = getKernelVersion() >= KernelVersion::Ventura;
         RouteRequestPlus requests[] = {
@@ -46,7 +47,7 @@ bool X6000::processKext(KernelPatcher &patcher, size_t index, mach_vm_address_t
             {"__ZN39AMDRadeonX6000_AMDAccelSharedUserClient5startEP9IOService", wrapAccelSharedUCStartX6000},
             {"__ZN39AMDRadeonX6000_AMDAccelSharedUserClient4stopEP9IOService", wrapAccelSharedUCStopX6000},
             {"__ZN30AMDRadeonX6000_AMDGFX10Display23initDCNRegistersOffsetsEv", wrapInitDCNRegistersOffsets,
-                this->orgInitDCNRegistersOffsets, NRed::callback->chipType < ChipType::Renoir},
+                this->orgInitDCNRegistersOffsets, !NRed::callback->chipProfile->dcn2},
             {"__ZN29AMDRadeonX6000_AMDAccelShared11SurfaceCopyEPjyP12IOAccelEvent", wrapAccelSharedSurfaceCopy,
                 this->orgAccelSharedSurfaceCopy},
             {"__ZN27AMDRadeonX6000_AMDHWDisplay17allocateScanoutFBEjP16IOAccelResource2S1_Py", wrapAllocateScanoutFB,
@@ -99,109 +100,172 @@ bool X6000::wrapAccelSharedUCStopX6000(void *that, void *provider) {
     return FunctionCast(wrapAccelSharedUCStopX6000, X5000::callback->orgAccelSharedUCStop)(that, provider);
 }
 
+struct DCNRegisterField {
+    uint32_t offset;       // Field offset from the register block base, for pipe 0
+    uint32_t reg;          // Register for pipe 0
+    uint32_t regStride;    // Register distance between pipes
+    uint32_t pipes;
+};
+
+/** Distance between the register offset fields of consecutive pipes in `AMDRadeonX6000_AMDGFX10Display`. */
+constexpr uint32_t DCN_FIELD_PIPE_STRIDE = 0x38;
+constexpr uint32_t DCN_HUBP_PIPES = 4;
+constexpr uint32_t DCN_OTG_PIPES = 6;
+constexpr uint32_t DCN_HUBP_REG_STRIDE = mmHUBP1_DCSURF_ADDR_CONFIG - mmHUBP0_DCSURF_ADDR_CONFIG;
+constexpr uint32_t DCN_OTG_REG_STRIDE = mmOTG1_OTG_CONTROL - mmOTG0_OTG_CONTROL;
+
+static constexpr DCNRegisterField dcnRegisterFields[] = {
+    {0x10, mmHUBPREQ0_DCSURF_PRIMARY_SURFACE_ADDRESS, DCN_HUBP_REG_STRIDE, DCN_HUBP_PIPES},
+    {0x14, mmHUBPREQ0_DCSURF_PRIMARY_SURFACE_ADDRESS_HIGH, DCN_HUBP_REG_STRIDE, DCN_HUBP_PIPES},
+    {0x18, mmHUBP0_DCSURF_SURFACE_CONFIG, DCN_HUBP_REG_STRIDE, DCN_HUBP_PIPES},
+    {0x1C, mmHUBPREQ0_DCSURF_SURFACE_PITCH, DCN_HUBP_REG_STRIDE, DCN_HUBP_PIPES},
+    {0x20, mmHUBP0_DCSURF_ADDR_CONFIG, DCN_HUBP_REG_STRIDE, DCN_HUBP_PIPES},
+    {0x24, mmHUBP0_DCSURF_TILING_CONFIG, DCN_HUBP_REG_STRIDE, DCN_HUBP_PIPES},
+    {0x28, mmHUBP0_DCSURF_PRI_VIEWPORT_START, DCN_HUBP_REG_STRIDE, DCN_HUBP_PIPES},
+    {0x2C, mmHUBP0_DCSURF_PRI_VIEWPORT_DIMENSION, DCN_HUBP_REG_STRIDE, DCN_HUBP_PIPES},
+    {0x30, mmOTG0_OTG_CONTROL, DCN_OTG_REG_STRIDE, DCN_OTG_PIPES},
+    {0x34, mmOTG0_OTG_INTERLACE_CONTROL, DCN_OTG_REG_STRIDE, DCN_OTG_PIPES},
+    {0x38, mmHUBPREQ0_DCSURF_FLIP_CONTROL, DCN_HUBP_REG_STRIDE, DCN_HUBP_PIPES},
+    {0x3C, mmHUBPRET0_HUBPRET_CONTROL, DCN_HUBP_REG_STRIDE, DCN_HUBP_PIPES},
+    {0x40, mmHUBPREQ0_DCSURF_SURFACE_EARLIEST_INUSE, DCN_HUBP_REG_STRIDE, DCN_HUBP_PIPES},
+    {0x44, mmHUBPREQ0_DCSURF_SURFACE_EARLIEST_INUSE_HIGH, DCN_HUBP_REG_STRIDE, DCN_HUBP_PIPES},
+};
+
+template<size_t N>
+static constexpr bool isRegStrided(const uint32_t (&regs)[N], uint32_t stride) {
+    for (size_t i = 0; i < N; i++) {
+        if (regs[i] != regs[0] + i * stride) { return false; }
+    }
+    return true;
+}
+
+static_assert(isRegStrided({mmHUBPREQ0_DCSURF_PRIMARY_SURFACE_ADDRESS, mmHUBPREQ1_DCSURF_PRIMARY_SURFACE_ADDRESS,
+                               mmHUBPREQ2_DCSURF_PRIMARY_SURFACE_ADDRESS, mmHUBPREQ3_DCSURF_PRIMARY_SURFACE_ADDRESS},
+    DCN_HUBP_REG_STRIDE));
+static_assert(isRegStrided({mmHUBPREQ0_DCSURF_PRIMARY_SURFACE_ADDRESS_HIGH,
+                               mmHUBPREQ1_DCSURF_PRIMARY_SURFACE_ADDRESS_HIGH,
+                               mmHUBPREQ2_DCSURF_PRIMARY_SURFACE_ADDRESS_HIGH,
+                               mmHUBPREQ3_DCSURF_PRIMARY_SURFACE_ADDRESS_HIGH},
+    DCN_HUBP_REG_STRIDE));
+static_assert(isRegStrided({mmHUBP0_DCSURF_SURFACE_CONFIG, mmHUBP1_DCSURF_SURFACE_CONFIG,
+                               mmHUBP2_DCSURF_SURFACE_CONFIG, mmHUBP3_DCSURF_SURFACE_CONFIG},
+    DCN_HUBP_REG_STRIDE));
+static_assert(isRegStrided({mmHUBPREQ0_DCSURF_SURFACE_PITCH, mmHUBPREQ1_DCSURF_SURFACE_PITCH,
+                               mmHUBPREQ2_DCSURF_SURFACE_PITCH, mmHUBPREQ3_DCSURF_SURFACE_PITCH},
+    DCN_HUBP_REG_STRIDE));
+static_assert(isRegStrided({mmHUBP0_DCSURF_ADDR_CONFIG, mmHUBP1_DCSURF_ADDR_CONFIG, mmHUBP2_DCSURF_ADDR_CONFIG,
+                               mmHUBP3_DCSURF_ADDR_CONFIG},
+    DCN_HUBP_REG_STRIDE));
+static_assert(isRegStrided({mmHUBP0_DCSURF_TILING_CONFIG, mmHUBP1_DCSURF_TILING_CONFIG,
+                               mmHUBP2_DCSURF_TILING_CONFIG, mmHUBP3_DCSURF_TILING_CONFIG},
+    DCN_HUBP_REG_STRIDE));
+static_assert(isRegStrided({mmHUBP0_DCSURF_PRI_VIEWPORT_START, mmHUBP1_DCSURF_PRI_VIEWPORT_START,
+                               mmHUBP2_DCSURF_PRI_VIEWPORT_START, mmHUBP3_DCSURF_PRI_VIEWPORT_START},
+    DCN_HUBP_REG_STRIDE));
+static_assert(isRegStrided({mmHUBP0_DCSURF_PRI_VIEWPORT_DIMENSION, mmHUBP1_DCSURF_PRI_VIEWPORT_DIMENSION,
+                               mmHUBP2_DCSURF_PRI_VIEWPORT_DIMENSION, mmHUBP3_DCSURF_PRI_VIEWPORT_DIMENSION},
+    DCN_HUBP_REG_STRIDE));
+static_assert(isRegStrided({mmOTG0_OTG_CONTROL, mmOTG1_OTG_CONTROL, mmOTG2_OTG_CONTROL, mmOTG3_OTG_CONTROL,
+                               mmOTG4_OTG_CONTROL, mmOTG5_OTG_CONTROL},
+    DCN_OTG_REG_STRIDE));
+static_assert(isRegStrided({mmOTG0_OTG_INTERLACE_CONTROL, mmOTG1_OTG_INTERLACE_CONTROL, mmOTG2_OTG_INTERLACE_CONTROL,
+                               mmOTG3_OTG_INTERLACE_CONTROL, mmOTG4_OTG_INTERLACE_CONTROL,
+                               mmOTG5_OTG_INTERLACE_CONTROL},
+    DCN_OTG_REG_STRIDE));
+static_assert(isRegStrided({mmHUBPREQ0_DCSURF_FLIP_CONTROL, mmHUBPREQ1_DCSURF_FLIP_CONTROL,
+                               mmHUBPREQ2_DCSURF_FLIP_CONTROL, mmHUBPREQ3_DCSURF_FLIP_CONTROL},
+    DCN_HUBP_REG_STRIDE));
+static_assert(isRegStrided({mmHUBPRET0_HUBPRET_CONTROL, mmHUBPRET1_HUBPRET_CONTROL, mmHUBPRET2_HUBPRET_CONTROL,
+                               mmHUBPRET3_HUBPRET_CONTROL},
+    DCN_HUBP_REG_STRIDE));
+static_assert(isRegStrided({mmHUBPREQ0_DCSURF_SURFACE_EARLIEST_INUSE, mmHUBPREQ1_DCSURF_SURFACE_EARLIEST_INUSE,
+                               mmHUBPREQ2_DCSURF_SURFACE_EARLIEST_INUSE, mmHUBPREQ3_DCSURF_SURFACE_EARLIEST_INUSE},
+    DCN_HUBP_REG_STRIDE));
+static_assert(isRegStrided({mmHUBPREQ0_DCSURF_SURFACE_EARLIEST_INUSE_HIGH,
+                               mmHUBPREQ1_DCSURF_SURFACE_EARLIEST_INUSE_HIGH,
+                               mmHUBPREQ2_DCSURF_SURFACE_EARLIEST_INUSE_HIGH,
+                               mmHUBPREQ3_DCSURF_SURFACE_EARLIEST_INUSE_HIGH},
+    DCN_HUBP_REG_STRIDE));
+
 void X6000::wrapInitDCNRegistersOffsets(void *that) {
     FunctionCast(wrapInitDCNRegistersOffsets, callback->orgInitDCNRegistersOffsets)(that);
     auto fieldBase = getKernelVersion() > KernelVersion::Monterey ? 0x590 : 0x4830;
     auto base = getMember<uint32_t>(that, fieldBase);
-    getMember<uint32_t>(that, fieldBase + 0x10) = base + mmHUBPREQ0_DCSURF_PRIMARY_SURFACE_ADDRESS;
-    getMember<uint32_t>(that, fieldBase + 0x48) = base + mmHUBPREQ1_DCSURF_PRIMARY_SURFACE_ADDRESS;
-    getMember<uint32_t>(that, fieldBase + 0x80) = base + mmHUBPREQ2_DCSURF_PRIMARY_SURFACE_ADDRESS;
-    getMember<uint32_t>(that, fieldBase + 0xB8) = base + mmHUBPREQ3_DCSURF_PRIMARY_SURFACE_ADDRESS;
-    getMember<uint32_t>(that, fieldBase + 0x14) = base + mmHUBPREQ0_DCSURF_PRIMARY_SURFACE_ADDRESS_HIGH;
-    getMember<uint32_t>(that, fieldBase + 0x4C) = base + mmHUBPREQ1_DCSURF_PRIMARY_SURFACE_ADDRESS_HIGH;
-    getMember<uint32_t>(that, fieldBase + 0x84) = base + mmHUBPREQ2_DCSURF_PRIMARY_SURFACE_ADDRESS_HIGH;
-    getMember<uint32_t>(that, fieldBase + 0xBC) = base + mmHUBPREQ3_DCSURF_PRIMARY_SURFACE_ADDRESS_HIGH;
-    getMember<uint32_t>(that, fieldBase + 0x18) = base + mmHUBP0_DCSURF_SURFACE_CONFIG;
-    getMember<uint32_t>(that, fieldBase + 0x50) = base + mmHUBP1_DCSURF_SURFACE_CONFIG;
-    getMember<uint32_t>(that, fieldBase + 0x88) = base + mmHUBP2_DCSURF_SURFACE_CONFIG;
-    getMember<uint32_t>(that, fieldBase + 0xC0) = base + mmHUBP3_DCSURF_SURFACE_CONFIG;
-    getMember<uint32_t>(that, fieldBase + 0x1C) = base + mmHUBPREQ0_DCSURF_SURFACE_PITCH;
-    getMember<uint32_t>(that, fieldBase + 0x54) = base + mmHUBPREQ1_DCSURF_SURFACE_PITCH;
-    getMember<uint32_t>(that, fieldBase + 0x8C) = base + mmHUBPREQ2_DCSURF_SURFACE_PITCH;
-    getMember<uint32_t>(that, fieldBase + 0xC4) = base + mmHUBPREQ3_DCSURF_SURFACE_PITCH;
-    getMember<uint32_t>(that, fieldBase + 0x20) = base + mmHUBP0_DCSURF_ADDR_CONFIG;
-    getMember<uint32_t>(that, fieldBase + 0x58) = base + mmHUBP1_DCSURF_ADDR_CONFIG;
-    getMember<uint32_t>(that, fieldBase + 0x90) = base + mmHUBP2_DCSURF_ADDR_CONFIG;
-    getMember<uint32_t>(that, fieldBase + 0xC8) = base + mmHUBP3_DCSURF_ADDR_CONFIG;
-    getMember<uint32_t>(that, fieldBase + 0x24) = base + mmHUBP0_DCSURF_TILING_CONFIG;
-    getMember<uint32_t>(that, fieldBase + 0x5C) = base + mmHUBP1_DCSURF_TILING_CONFIG;
-    getMember<uint32_t>(that, fieldBase + 0x94) = base + mmHUBP2_DCSURF_TILING_CONFIG;
-    getMember<uint32_t>(that, fieldBase + 0xCC) = base + mmHUBP3_DCSURF_TILING_CONFIG;
-    getMember<uint32_t>(that, fieldBase + 0x28) = base + mmHUBP0_DCSURF_PRI_VIEWPORT_START;
-    getMember<uint32_t>(that, fieldBase + 0x60) = base + mmHUBP1_DCSURF_PRI_VIEWPORT_START;
-    getMember<uint32_t>(that, fieldBase + 0x98) = base + mmHUBP2_DCSURF_PRI_VIEWPORT_START;
-    getMember<uint32_t>(that, fieldBase + 0xD0) = base + mmHUBP3_DCSURF_PRI_VIEWPORT_START;
-    getMember<uint32_t>(that, fieldBase + 0x2C) = base + mmHUBP0_DCSURF_PRI_VIEWPORT_DIMENSION;
-    getMember<uint32_t>(that, fieldBase + 0x64) = base + mmHUBP1_DCSURF_PRI_VIEWPORT_DIMENSION;
-    getMember<uint32_t>(that, fieldBase + 0x9C) = base + mmHUBP2_DCSURF_PRI_VIEWPORT_DIMENSION;
-    getMember<uint32_t>(that, fieldBase + 0xD4) = base + mmHUBP3_DCSURF_PRI_VIEWPORT_DIMENSION;
-    getMember<uint32_t>(that, fieldBase + 0x30) = base + mmOTG0_OTG_CONTROL;
-    getMember<uint32_t>(that, fieldBase + 0x68) = base + mmOTG1_OTG_CONTROL;
-    getMember<uint32_t>(that, fieldBase + 0xA0) = base + mmOTG2_OTG_CONTROL;
-    getMember<uint32_t>(that, fieldBase + 0xD8) = base + mmOTG3_OTG_CONTROL;
-    getMember<uint32_t>(that, fieldBase + 0x110) = base + mmOTG4_OTG_CONTROL;
-    getMember<uint32_t>(that, fieldBase + 0x148) = base + mmOTG5_OTG_CONTROL;
-    getMember<uint32_t>(that, fieldBase + 0x34) = base + mmOTG0_OTG_INTERLACE_CONTROL;
-    getMember<uint32_t>(that, fieldBase + 0x6C) = base + mmOTG1_OTG_INTERLACE_CONTROL;
-    getMember<uint32_t>(that, fieldBase + 0xA4) = base + mmOTG2_OTG_INTERLACE_CONTROL;
-    getMember<uint32_t>(that, fieldBase + 0xDC) = base + mmOTG3_OTG_INTERLACE_CONTROL;
-    getMember<uint32_t>(that, fieldBase + 0x114) = base + mmOTG4_OTG_INTERLACE_CONTROL;
-    getMember<uint32_t>(that, fieldBase + 0x14C) = base + mmOTG5_OTG_INTERLACE_CONTROL;
-    getMember<uint32_t>(that, fieldBase + 0x38) = base + mmHUBPREQ0_DCSURF_FLIP_CONTROL;
-    getMember<uint32_t>(that, fieldBase + 0x70) = base + mmHUBPREQ1_DCSURF_FLIP_CONTROL;
-    getMember<uint32_t>(that, fieldBase + 0xA8) = base + mmHUBPREQ2_DCSURF_FLIP_CONTROL;
-    getMember<uint32_t>(that, fieldBase + 0xE0) = base + mmHUBPREQ3_DCSURF_FLIP_CONTROL;
-    getMember<uint32_t>(that, fieldBase + 0x3C) = base + mmHUBPRET0_HUBPRET_CONTROL;
-    getMember<uint32_t>(that, fieldBase + 0x74) = base + mmHUBPRET1_HUBPRET_CONTROL;
-    getMember<uint32_t>(that, fieldBase + 0xAC) = base + mmHUBPRET2_HUBPRET_CONTROL;
-    getMember<uint32_t>(that, fieldBase + 0xE4) = base + mmHUBPRET3_HUBPRET_CONTROL;
-    getMember<uint32_t>(that, fieldBase + 0x40) = base + mmHUBPREQ0_DCSURF_SURFACE_EARLIEST_INUSE;
-    getMember<uint32_t>(that, fieldBase + 0x78) = base + mmHUBPREQ1_DCSURF_SURFACE_EARLIEST_INUSE;
-    getMember<uint32_t>(that, fieldBase + 0xB0) = base + mmHUBPREQ2_DCSURF_SURFACE_EARLIEST_INUSE;
-    getMember<uint32_t>(that, fieldBase + 0xE8) = base + mmHUBPREQ3_DCSURF_SURFACE_EARLIEST_INUSE;
-    getMember<uint32_t>(that, fieldBase + 0x44) = base + mmHUBPREQ0_DCSURF_SURFACE_EARLIEST_INUSE_HIGH;
-    getMember<uint32_t>(that, fieldBase + 0x7C) = base + mmHUBPREQ1_DCSURF_SURFACE_EARLIEST_INUSE_HIGH;
-    getMember<uint32_t>(that, fieldBase + 0xB4) = base + mmHUBPREQ2_DCSURF_SURFACE_EARLIEST_INUSE_HIGH;
-    getMember<uint32_t>(that, fieldBase + 0xEC) = base + mmHUBPREQ3_DCSURF_SURFACE_EARLIEST_INUSE_HIGH;
+    for (const auto &field : dcnRegisterFields) {
+        for (uint32_t pipe = 0; pipe < field.pipes; pipe++) {
+            getMember<uint32_t>(that, fieldBase + field.offset + pipe * DCN_FIELD_PIPE_STRIDE) =
+                base + field.reg + pipe * field.regStride;
+        }
+    }
 }
 
-#define HWALIGNMGR_ADJUST getMember<void *>(X5000::callback->hwAlignMgr, 0) = X5000::callback->hwAlignMgrVtX6000;
-#define HWALIGNMGR_REVERT getMember<void *>(X5000::callback->hwAlignMgr, 0) = X5000::callback->hwAlignMgrVtX5000;
+/**
+ * The X6000 display and blit paths expect the X6000 `AMDHWAlignManager2` vtable layout.
+ * Keep the hybrid vtable installed while any of them is running, so that one returning does not revert it
+ * underneath another. Users are counted per manager and the scope reverts the one it patched, so a new manager
+ * being allocated in the meantime cannot leave the old one with the hybrid vtable.
+ */
+class HWAlignMgrX6000Scope {
+    public:
+    HWAlignMgrX6000Scope() {
+        auto *x5000 = X5000::callback;
+        IOSimpleLockLock(x5000->hwAlignMgrLock);
+        this->mgr = x5000->hwAlignMgr;
+        HWAlignMgrX6000Users *users = nullptr, *free = nullptr;
+        for (auto &ent : x5000->hwAlignMgrX6000Users) {
+            if (ent.users && ent.mgr == this->mgr) {
+                users = &ent;
+                break;
+            }
+            if (!ent.users && !free) { free = &ent; }
+        }
+        if (!users) {
+            PANIC_COND(!free, "x6000", "Too many align managers in use");
+            users = free;
+            users->mgr = this->mgr;
+            getMember<const mach_vm_address_t *>(this->mgr, 0) = x5000->hwAlignMgrVtX6000;
+        }
+        users->users++;
+        IOSimpleLockUnlock(x5000->hwAlignMgrLock);
+    }
+
+    ~HWAlignMgrX6000Scope() {
+        auto *x5000 = X5000::callback;
+        IOSimpleLockLock(x5000->hwAlignMgrLock);
+        for (auto &ent : x5000->hwAlignMgrX6000Users) {
+            if (!ent.users || ent.mgr != this->mgr) { continue; }
+            if (!--ent.users) { getMember<const mach_vm_address_t *>(this->mgr, 0) = x5000->hwAlignMgrVtX5000; }
+            break;
+        }
+        IOSimpleLockUnlock(x5000->hwAlignMgrLock);
+    }
+
+    private:
+    void *mgr;
+};
 
 uint64_t X6000::wrapAccelSharedSurfaceCopy(void *that, void *param1, uint64_t param2, void *param3) {
-    HWALIGNMGR_ADJUST
-    auto ret =
-        FunctionCast(wrapAccelSharedSurfaceCopy, callback->orgAccelSharedSurfaceCopy)(that, param1, param2, param3);
-    HWALIGNMGR_REVERT
-    return ret;
+    HWAlignMgrX6000Scope scope;
+    return FunctionCast(wrapAccelSharedSurfaceCopy, callback->orgAccelSharedSurfaceCopy)(that, param1, param2, param3);
 }
 
 uint64_t X6000::wrapAllocateScanoutFB(void *that, uint32_t param1, void *param2, void *param3, void *param4) {
-    HWALIGNMGR_ADJUST
-    auto ret =
-        FunctionCast(wrapAllocateScanoutFB, callback->orgAllocateScanoutFB)(that, param1, param2, param3, param4);
-    HWALIGNMGR_REVERT
-    return ret;
+    HWAlignMgrX6000Scope scope;
+    return FunctionCast(wrapAllocateScanoutFB, callback->orgAllocateScanoutFB)(that, param1, param2, param3, param4);
 }
 
 uint64_t X6000::wrapFillUBMSurface(void *that, uint32_t param1, void *param2, void *param3) {
-    HWALIGNMGR_ADJUST
-    auto ret = FunctionCast(wrapFillUBMSurface, callback->orgFillUBMSurface)(that, param1, param2, param3);
-    HWALIGNMGR_REVERT
-    return ret;
+    HWAlignMgrX6000Scope scope;
+    return FunctionCast(wrapFillUBMSurface, callback->orgFillUBMSurface)(that, param1, param2, param3);
 }
 
 bool X6000::wrapConfigureDisplay(void *that, uint32_t param1, uint32_t param2, void *param3, void *param4) {
-    HWALIGNMGR_ADJUST
-    auto ret = FunctionCast(wrapConfigureDisplay, callback->orgConfigureDisplay)(that, param1, param2, param3, param4);
-    HWALIGNMGR_REVERT
-    return ret;
+    HWAlignMgrX6000Scope scope;
+    return FunctionCast(wrapConfigureDisplay, callback->orgConfigureDisplay)(that, param1, param2, param3, param4);
 }
 
 uint64_t X6000::wrapGetDisplayInfo(void *that, uint32_t param1, bool param2, bool param3, void *param4, void *param5) {
-    HWALIGNMGR_ADJUST
-    auto ret =
-        FunctionCast(wrapGetDisplayInfo, callback->orgGetDisplayInfo)(that, param1, param2, param3, param4, param5);
-    HWALIGNMGR_REVERT
-    return ret;
+    HWAlignMgrX6000Scope scope;
+    return FunctionCast(wrapGetDisplayInfo, callback->orgGetDisplayInfo)(that, param1, param2, param3, param4,
+        param5);
 }
@@ -18,16 +18,25 @@ X6000FB *X6000FB::callback = nullptr;
 
 void X6000FB::init() {
     callback = this;
+
+    this->backlightLock = IOLockAlloc();
+    PANIC_COND(!this->backlightLock, "x6000fb", "Failed to allocate backlight lock");
+    this->backlightCall = thread_call_allocate(processBacklight, this);
+    PANIC_COND(!this->backlightCall, "x6000fb", "Failed to allocate backlight thread call");
+    nanoseconds_to_absolutetime(BACKLIGHT_MIN_INTERVAL_MSEC * 1000000ULL, &this->backlightInterval);
+
     lilu.onKextLoadForce(&kextRadeonX6000Framebuffer);
 }
 
 bool X6000FB::processKext(KernelPatcher &patcher, size_t index, mach_vm_address_t address, size_t size) {
     if (kextRadeonX6000Framebuffer.loadIndex == index) {
-        NRed::callback->setRMMIOIfNecessary();
+        if (!NRed::callback->setRMMIOIfNecessary()) { return true; }
 
         CAILAsicCapsEntry *orgAsicCapsTable = nullptr;
 
         auto ventura = getKernelVersion() >= KernelVersion::Ventura;
+        // The IH fixups are only needed on Renoir and newer, so older chips keep the original functions.
+        auto renoir = NRed::callback->chipProfile->gfx93;
         SolveRequestPlus solveRequests[] = {
             {"__ZL20CAIL_ASIC_CAPS_TABLE", orgAsicCapsTable, kCailAsicCapsTablePattern},
             {"_dce_driver_set_backlight", this->orgDceDriverSetBacklight, kDceDriverSetBacklight},
@@ -47,12 +56,10 @@ bool X6000FB::processKext(KernelPatcher &patcher, size_t index, mach_vm_address_
                 this->orgFramebufferSetAttribute},
             {"__ZN35AMDRadeonX6000_AmdRadeonFramebuffer25getAttributeForConnectionEijPm", wrapFramebufferGetAttribute,
                 this->orgFramebufferGetAttribute},
-            {"__ZNK22AmdAtomObjectInfo_V1_421getNumberOfConnectorsEv", wrapGetNumberOfConnectors,
-                this->orgGetNumberOfConnectors, kGetNumberOfConnectorsPattern, kGetNumberOfConnectorsMask},
             {"_IH_4_0_IVRing_InitHardware", wrapIH40IVRingInitHardware, this->orgIH40IVRingInitHardware,
-                kIH40IVRingInitHardwarePattern, kIH40IVRingInitHardwareMask},
+                kIH40IVRingInitHardwarePattern, kIH40IVRingInitHardwareMask, renoir},
             {"_IRQMGR_WriteRegister", wrapIRQMGRWriteRegister, this->orgIRQMGRWriteRegister,
-                kIRQMGRWriteRegisterPattern},
+                kIRQMGRWriteRegisterPattern, renoir},
             {"__ZN34AMDRadeonX6000_AmdRadeonController7powerUpEv", wrapControllerPowerUp, this->orgControllerPowerUp,
                 ventura},
         };
@@ -78,7 +85,7 @@ bool X6000FB::processKext(KernelPatcher &patcher, size_t index, mach_vm_address_
             "Failed to enable kernel writing");
         *orgAsicCapsTable = {
             .familyId = AMDGPU_FAMILY_RAVEN,
-            .caps = NRed::callback->chipType < ChipType::Renoir ? ddiCapsRaven : ddiCapsRenoir,
+            .caps = NRed::callback->chipProfile->ddiCaps,
             .deviceId = NRed::callback->deviceId,
             .revision = NRed::callback->revision,
             .extRevision = static_cast<uint32_t>(NRed::callback->enumRevision) + NRed::callback->revision,
@@ -96,74 +103,8 @@ bool X6000FB::processKext(KernelPatcher &patcher, size_t index, mach_vm_address_
 uint16_t X6000FB::wrapGetEnumeratedRevision() { return NRed::callback->enumRevision; }
 
 IOReturn X6000FB::wrapPopulateVramInfo(void *, void *fwInfo) {
-    uint32_t channelCount = 1;
-    auto *table = NRed::callback->getVBIOSDataTable<IGPSystemInfo>(0x1E);
-    uint8_t memoryType = 0;
-    if (table) {
-        DBGLOG("x6000fb", "Fetching VRAM info from iGPU System Info");
-        switch (table->header.formatRev) {
-            case 1:
-                switch (table->header.contentRev) {
-                    case 11:
-                        [[fallthrough]];
-                    case 12:
-                        if (table->infoV11.umaChannelCount) { channelCount = table->infoV11.umaChannelCount; }
-                        memoryType = table->infoV11.memoryType;
-                        break;
-                    default:
-                        DBGLOG("x6000fb", "Unsupported contentRev %d", table->header.contentRev);
-                        break;
-                }
-                break;
-            case 2:
-                switch (table->header.contentRev) {
-                    case 1:
-                        [[fallthrough]];
-                    case 2:
-                        if (table->infoV2.umaChannelCount) { channelCount = table->infoV2.umaChannelCount; }
-                        memoryType = table->infoV2.memoryType;
-                        break;
-                    default:
-                        DBGLOG("x6000fb", "Unsupported contentRev %d", table->header.contentRev);
-                        break;
-                }
-                break;
-            default:
-                DBGLOG("x6000fb", "Unsupported formatRev %d", table->header.formatRev);
-                break;
-        }
-    } else {
-        DBGLOG("x6000fb", "No iGPU System Info in Master Data Table");
-    }
-    auto &videoMemoryType = getMember<uint32_t>(fwInfo, 0x1C);
-    switch (memoryType) {
-        case kDDR2MemType:
-            [[fallthrough]];
-        case kDDR2FBDIMMMemType:
-            [[fallthrough]];
-        case kLPDDR2MemType:
-            videoMemoryType = kVideoMemoryTypeDDR2;
-            break;
-        case kDDR3MemType:
-            [[fallthrough]];
-        case kLPDDR3MemType:
-            videoMemoryType = kVideoMemoryTypeDDR3;
-            break;
-        case kDDR4MemType:
-            [[fallthrough]];
-        case kLPDDR4MemType:
-            [[fallthrough]];
-        case kDDR5MemType:    // AMD's Kexts don't know about DDR5
-            [[fallthrough]];
-        case kLPDDR5MemType:
-            videoMemoryType = kVideoMemoryTypeDDR4;
-            break;
-        default:
-            DBGLOG("x6000fb", "Unsupported memory type %d", memoryType);
-            videoMemoryType = kVideoMemoryTypeUnknown;
-            break;
-    }
-    getMember<uint32_t>(fwInfo, 0x20) = channelCount * 64;    // VRAM Width (64-bit channels)
+    getMember<uint32_t>(fwInfo, 0x1C) = NRed::callback->videoMemoryType;
+    getMember<uint32_t>(fwInfo, 0x20) = NRed::callback->vramWidth;
     return kIOReturnSuccess;
 }
 
@@ -207,9 +148,18 @@ void X6000FB::registerDispMaxBrightnessNotif() {
     matching->release();
 }
 
+/**
+ * Deferred and ramped writes run from `backlightCall`, so the lock is held across the init to keep them off the panel
+ * controller until it is done.
+ */
 uint32_t X6000FB::wrapDcePanelCntlHwInit(void *panelCntl) {
+    IOLockLock(callback->backlightLock);
     callback->panelCntlPtr = panelCntl;
-    return FunctionCast(wrapDcePanelCntlHwInit, callback->orgDcePanelCntlHwInit)(panelCntl);
+    // The panel may come back with a different level, so the next request must reach the hardware.
+    callback->lastBacklightApply = 0;
+    auto ret = FunctionCast(wrapDcePanelCntlHwInit, callback->orgDcePanelCntlHwInit)(panelCntl);
+    IOLockUnlock(callback->backlightLock);
+    return ret;
 }
 
 IOReturn X6000FB::wrapFramebufferSetAttribute(IOService *framebuffer, IOIndex connectIndex, IOSelect attribute,
@@ -236,8 +186,15 @@ IOReturn X6000FB::wrapFramebufferSetAttribute(IOService *framebuffer, IOIndex co
     // Set the backlight
     callback->curPwmBacklightLvl = static_cast<uint32_t>(value);
     uint32_t percentage = callback->curPwmBacklightLvl * 100 / callback->maxPwmBacklightLvl;
-    uint32_t pwmValue = 0;
-    if (percentage >= 100) {
+    callback->setBacklightPercentage(percentage > 100 ? 100 : percentage);
+    return kIOReturnSuccess;
+}
+
+struct BacklightPwmTable {
+    uint32_t value[101] {};
+
+    constexpr BacklightPwmTable() {
+        for (uint32_t i = 0; i < 100; i++) { value[i] = ((i * 0xFF) / 100) << 8U; }
         // This is from the dmcu_set_backlight_level function of Linux source
         // ...
         // if (backlight_pwm_u16_16 & 0x10000)
@@ -246,13 +203,83 @@ IOReturn X6000FB::wrapFramebufferSetAttribute(IOService *framebuffer, IOIndex co
         // 	   backlight_8_bit = (backlight_pwm_u16_16 >> 8) & 0xFF;
         // ...
         // The max brightness should have 0x10000 bit set
-        pwmValue = 0x1FF00;
+        value[100] = 0x1FF00;
+    }
+};
+
+static constexpr BacklightPwmTable backlightPwmTable {};
+/** The conversion the table replaced, done at runtime on every brightness change. */
+static constexpr uint32_t getBacklightPwm(uint32_t percentage) {
+    return percentage >= 100 ? 0x1FF00 : ((percentage * 0xFF) / 100) << 8U;
+}
+
+static constexpr bool backlightPwmTableMatches() {
+    for (uint32_t i = 0; i <= 100; i++) {
+        if (backlightPwmTable.value[i] != getBacklightPwm(i)) { return false; }
+    }
+    return true;
+}
+
+static_assert(backlightPwmTableMatches(), "Unexpected backlight PWM table");
+
+void X6000FB::setBacklightPercentage(uint32_t percentage) {
+    IOLockLock(this->backlightLock);
+    if (percentage != this->targetPercentage) {
+        this->targetPercentage = percentage;
+        this->rampFromPercentage = this->appliedPercentage;
+        this->rampStep = 0;
+    }
+    // A write is already scheduled; it will pick up the latest level.
+    if (!this->backlightCallPending) {
+        auto deadline = this->lastBacklightApply + this->backlightInterval;
+        if (mach_absolute_time() >= deadline) {
+            // Leading edge: a lone request, or the first one after an idle period, starts moving right away.
+            this->applyBacklightLocked();
+        } else {
+            this->backlightCallPending = true;
+            thread_call_enter_delayed(this->backlightCall, deadline);
+        }
+    }
+    IOLockUnlock(this->backlightLock);
+}
+
+void X6000FB::applyBacklightLocked() {
+    uint32_t next;
+    if (!this->lastBacklightApply) {
+        // The level the panel is at is unknown, so there is nothing to ramp from.
+        next = this->targetPercentage;
+    } else if (this->appliedPercentage == this->targetPercentage) {
+        return;
     } else {
-        pwmValue = ((percentage * 0xFF) / 100) << 8U;
+        this->rampStep++;
+        auto from = static_cast<int32_t>(this->rampFromPercentage);
+        auto delta = static_cast<int32_t>(this->targetPercentage) - from;
+        next = static_cast<uint32_t>(from + delta * static_cast<int32_t>(this->rampStep) /
+                                                static_cast<int32_t>(BACKLIGHT_RAMP_STEPS));
     }
 
-    callback->orgDceDriverSetBacklight(callback->panelCntlPtr, pwmValue);
-    return kIOReturnSuccess;
+    this->orgDceDriverSetBacklight(this->panelCntlPtr, backlightPwmTable.value[next]);
+    this->appliedPercentage = next;
+    this->lastBacklightApply = mach_absolute_time();
+
+    if (next != this->targetPercentage) {
+        this->backlightCallPending = true;
+        thread_call_enter_delayed(this->backlightCall, this->lastBacklightApply + this->backlightInterval);
+    }
+}
+
+/**
+ * `dce_driver_set_backlight` only programs the panel controller's `BL_PWM` registers, under the hardware's own
+ * `BL_PWM_GRP1_REG_LOCK`, and none of the display pipe programming touches those. Like Linux, which calls it from the
+ * backlight device rather than the commit path, it is therefore safe to call outside the framebuffer's context.
+ * The only other user of the panel controller is its init, which `backlightLock` keeps us out of.
+ */
+void X6000FB::processBacklight(thread_call_param_t param0, thread_call_param_t) {
+    auto *that = static_cast<X6000FB *>(param0);
+    IOLockLock(that->backlightLock);
+    that->backlightCallPending = false;
+    that->applyBacklightLocked();
+    IOLockUnlock(that->backlightLock);
 }
 
 IOReturn X6000FB::wrapFramebufferGetAttribute(IOService *framebuffer, IOIndex connectIndex, IOSelect attribute,
@@ -267,39 +294,30 @@ IOReturn X6000FB::wrapFramebufferGetAttribute(IOService *framebuffer, IOIndex co
     return ret;
 }
 
-uint32_t X6000FB::wrapGetNumberOfConnectors(void *that) {
-    static bool once = false;
-    if (!once) {
-        once = true;
-        struct DispObjInfoTableV1_4 *objInfo = getMember<DispObjInfoTableV1_4 *>(that, 0x28);
-        if (objInfo->formatRev == 1 && (objInfo->contentRev == 4 || objInfo->contentRev == 5)) {
-            DBGLOG("nred", "Fixing VBIOS connectors");
-            auto n = objInfo->pathCount;
-            for (size_t i = 0, j = 0; i < n; i++) {
-                // Skip invalid device tags
-                if (objInfo->paths[i].devTag) {
-                    objInfo->paths[j++] = objInfo->paths[i];
-                } else {
-                    objInfo->pathCount--;
-                }
-            }
-        }
-    }
-    return FunctionCast(wrapGetNumberOfConnectors, callback->orgGetNumberOfConnectors)(that);
-}
-
 bool X6000FB::wrapIH40IVRingInitHardware(void *ctx, void *param2) {
     auto ret = FunctionCast(wrapIH40IVRingInitHardware, callback->orgIH40IVRingInitHardware)(ctx, param2);
-    if (NRed::callback->chipType >= ChipType::Renoir) {
-        NRed::callback->writeReg32(mmIH_CHICKEN, NRed::callback->readReg32(mmIH_CHICKEN) | mmIH_MC_SPACE_GPA_ENABLE);
-    }
+    NRed::callback->updateReg32(mmIH_CHICKEN, mmIH_MC_SPACE_GPA_ENABLE, mmIH_MC_SPACE_GPA_ENABLE);
     return ret;
 }
 
+/**
+ * Mirror `DBUS_MUX_CLK_SOFT_OVERRIDE` into `IH_BUFFER_MEM_CLK_SOFT_OVERRIDE` for `IH_CLK_CTRL` writes.
+ */
+static constexpr uint32_t fixupIHClkCtrl(uint32_t value) {
+    return value | ((value & (1U << mmIH_DBUS_MUX_CLK_SOFT_OVERRIDE_SHIFT)) >>
+                       (mmIH_DBUS_MUX_CLK_SOFT_OVERRIDE_SHIFT - mmIH_IH_BUFFER_MEM_CLK_SOFT_OVERRIDE_SHIFT));
+}
+
+static_assert(fixupIHClkCtrl(0) == 0);
+static_assert(fixupIHClkCtrl(1U << mmIH_DBUS_MUX_CLK_SOFT_OVERRIDE_SHIFT) ==
+              ((1U << mmIH_DBUS_MUX_CLK_SOFT_OVERRIDE_SHIFT) | (1U << mmIH_IH_BUFFER_MEM_CLK_SOFT_OVERRIDE_SHIFT)));
+static_assert(fixupIHClkCtrl(1U << mmIH_IH_BUFFER_MEM_CLK_SOFT_OVERRIDE_SHIFT) ==
+              (1U << mmIH_IH_BUFFER_MEM_CLK_SOFT_OVERRIDE_SHIFT));
+static_assert(fixupIHClkCtrl(0x0FFFFFFF & ~(1U << mmIH_IH_BUFFER_MEM_CLK_SOFT_OVERRIDE_SHIFT)) == 0x0FFFFFFF);
+
 void X6000FB::wrapIRQMGRWriteRegister(void *ctx, uint64_t index, uint32_t value) {
-    if (index == mmIH_CLK_CTRL && NRed::callback->chipType >= ChipType::Renoir) {
-        index |= (index & (1U << mmIH_DBUS_MUX_CLK_SOFT_OVERRIDE_SHIFT)) >>
-                 (mmIH_DBUS_MUX_CLK_SOFT_OVERRIDE_SHIFT - mmIH_IH_BUFFER_MEM_CLK_SOFT_OVERRIDE_SHIFT);
+    if (index == mmIH_CLK_CTRL) {
+        value = fixupIHClkCtrl(value);
         DBGLOG("x6000fb", "_IRQMGR_WriteRegister: Set IH_BUFFER_MEM_CLK_SOFT_OVERRIDE");
     }
     FunctionCast(wrapIRQMGRWriteRegister, callback->orgIRQMGRWriteRegister)(ctx, index, value);
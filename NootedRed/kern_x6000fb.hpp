@@ -5,10 +5,20 @@
 #include <Headers/kern_patcher.hpp>
 #include <IOKit/IOService.h>
 #include <IOKit/graphics/IOGraphicsTypes.h>
+#include <kern/thread_call.h>
 
 using t_DceDriverSetBacklight = void (*)(void *panelCntl, uint32_t backlightPwm);
 using t_MessageAccelerator = IOReturn (*)(void *that, uint32_t requestType, void *arg2, void *arg3, void *arg4);
 
+/**
+ * Minimum time between two DMCU backlight writes.
+ * Requests arriving faster than this are coalesced, and only the latest level is applied.
+ */
+constexpr uint32_t BACKLIGHT_MIN_INTERVAL_MSEC = 16;
+
+/** Number of backlight writes a brightness transition is spread over, one per `BACKLIGHT_MIN_INTERVAL_MSEC`. */
+constexpr uint32_t BACKLIGHT_RAMP_STEPS = 8;
+
 class X6000FB {
     friend class PRODUCT_NAME;
 
@@ -23,14 +33,21 @@ class X6000FB {
     mach_vm_address_t orgFramebufferSetAttribute {0}, orgFramebufferGetAttribute {0};
     uint32_t curPwmBacklightLvl {0}, maxPwmBacklightLvl {0xFF7B};
     void *panelCntlPtr {nullptr};
+    IOLock *backlightLock {nullptr};
+    thread_call_t backlightCall {nullptr};
+    uint64_t backlightInterval {0}, lastBacklightApply {0};
+    uint32_t targetPercentage {0}, appliedPercentage {0}, rampFromPercentage {0}, rampStep {0};
+    bool backlightCallPending {false};
     IONotifier *dispNotif {nullptr};
-    mach_vm_address_t orgGetNumberOfConnectors {0};
     mach_vm_address_t orgIH40IVRingInitHardware {0}, orgIRQMGRWriteRegister {0};
     t_MessageAccelerator orgMessageAccelerator {nullptr};
     mach_vm_address_t orgControllerPowerUp {0};
 
     static bool OnAppleBacklightDisplayLoad(void *target, void *refCon, IOService *newService, IONotifier *notifier);
     void registerDispMaxBrightnessNotif();
+    void setBacklightPercentage(uint32_t percentage);
+    void applyBacklightLocked();
+    static void processBacklight(thread_call_param_t param0, thread_call_param_t param1);
 
     static uint16_t wrapGetEnumeratedRevision();
     static IOReturn wrapPopulateVramInfo(void *that, void *fwInfo);
@@ -39,7 +56,6 @@ class X6000FB {
         uintptr_t value);
     static IOReturn wrapFramebufferGetAttribute(IOService *framebuffer, IOIndex connectIndex, IOSelect attribute,
         uintptr_t *value);
-    static uint32_t wrapGetNumberOfConnectors(void *that);
     static bool wrapIH40IVRingInitHardware(void *ctx, void *param2);
     static void wrapIRQMGRWriteRegister(void *ctx, uint64_t index, uint32_t value);
     static uint32_t wrapControllerPowerUp(void *that);